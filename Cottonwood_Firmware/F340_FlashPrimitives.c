@@ -23,6 +23,7 @@
 // Includes
 //-----------------------------------------------------------------------------
 
+#include "as399x_config.h"
 #include "F340_FlashPrimitives.h"
 #include <c8051F340.h>
 
@@ -126,7 +127,9 @@ unsigned char FLASH_ByteRead (FLADDR addr)
 
    return byte;
 }
+#endif
 
+#if WATCHLIST /* only the watchlist erases flash */
 //-----------------------------------------------------------------------------
 // FLASH_PageErase
 //-----------------------------------------------------------------------------
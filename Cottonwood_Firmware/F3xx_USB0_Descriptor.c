@@ -195,6 +195,34 @@ code const hid_report_descriptor HIDREPORTDESC =
     HID_REPORT_DESC_ENTRY(OUT_START_STOP_ID, OUT_START_STOP_IDSize, HID_REPORT_DESC_DIR_OUT),
     HID_REPORT_DESC_ENTRY(IN_GENERIC_COMMAND_ID, IN_GENERIC_COMMAND_IDSize, HID_REPORT_DESC_DIR_IN),
     HID_REPORT_DESC_ENTRY(OUT_GENERIC_COMMAND_ID, OUT_GENERIC_COMMAND_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(OUT_MACRO_ID, OUT_MACRO_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_MACRO_ID, IN_MACRO_IDSize, HID_REPORT_DESC_DIR_IN),
+    HID_REPORT_DESC_ENTRY(OUT_SYS_STATUS_ID, OUT_SYS_STATUS_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_SYS_STATUS_ID, IN_SYS_STATUS_IDSize, HID_REPORT_DESC_DIR_IN),
+    HID_REPORT_DESC_ENTRY(OUT_INVENTORY_STATS_ID, OUT_INVENTORY_STATS_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_INVENTORY_STATS_ID, IN_INVENTORY_STATS_IDSize, HID_REPORT_DESC_DIR_IN),
+    HID_REPORT_DESC_ENTRY(OUT_TRACE_DUMP_ID, OUT_TRACE_DUMP_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_TRACE_DUMP_ID, IN_TRACE_DUMP_IDSize, HID_REPORT_DESC_DIR_IN),
+    HID_REPORT_DESC_ENTRY(OUT_BENCH_ID, OUT_BENCH_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_BENCH_ID, IN_BENCH_IDSize, HID_REPORT_DESC_DIR_IN),
+    HID_REPORT_DESC_ENTRY(OUT_PROFILE_CTRL_ID, OUT_PROFILE_CTRL_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_PROFILE_CTRL_ID, IN_PROFILE_CTRL_IDSize, HID_REPORT_DESC_DIR_IN),
+    HID_REPORT_DESC_ENTRY(OUT_TAG_COUNT_ID, OUT_TAG_COUNT_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_TAG_COUNT_ID, IN_TAG_COUNT_IDSize, HID_REPORT_DESC_DIR_IN),
+    HID_REPORT_DESC_ENTRY(OUT_WATCHLIST_ID, OUT_WATCHLIST_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_WATCHLIST_ID, IN_WATCHLIST_IDSize, HID_REPORT_DESC_DIR_IN),
+    HID_REPORT_DESC_ENTRY(OUT_CARRIER_HOLD_ID, OUT_CARRIER_HOLD_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_CARRIER_HOLD_ID, IN_CARRIER_HOLD_IDSize, HID_REPORT_DESC_DIR_IN),
+    HID_REPORT_DESC_ENTRY(OUT_POWER_CTRL_ID, OUT_POWER_CTRL_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_POWER_CTRL_ID, IN_POWER_CTRL_IDSize, HID_REPORT_DESC_DIR_IN),
+    HID_REPORT_DESC_ENTRY(OUT_ACCESS_SEQ_ID, OUT_ACCESS_SEQ_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_ACCESS_SEQ_ID, IN_ACCESS_SEQ_IDSize, HID_REPORT_DESC_DIR_IN),
+    HID_REPORT_DESC_ENTRY(OUT_ENCODER_ID, OUT_ENCODER_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_ENCODER_ID, IN_ENCODER_IDSize, HID_REPORT_DESC_DIR_IN),
+    HID_REPORT_DESC_ENTRY(OUT_STREAM_READ_ID, OUT_STREAM_READ_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_STREAM_READ_ID, IN_STREAM_READ_IDSize, HID_REPORT_DESC_DIR_IN),
+    HID_REPORT_DESC_ENTRY(OUT_TAG_CACHE_ID, OUT_TAG_CACHE_IDSize, HID_REPORT_DESC_DIR_OUT),
+    HID_REPORT_DESC_ENTRY(IN_TAG_CACHE_ID, IN_TAG_CACHE_IDSize, HID_REPORT_DESC_DIR_IN),
     0xC0                           /*   end Application Collection */
 };
 
@@ -152,7 +152,7 @@ hid_configuration_descriptor;
 
 /*! number of report descriptor entries. This number needs to be updated if new
    entries are added */
-#define HID_REPORT_DESC_NUM_ENTRIES 52
+#define HID_REPORT_DESC_NUM_ENTRIES 80
 
 #define HID_REPORT_DESCRIPTOR_SIZE ((HID_REPORT_DESC_NUM_ENTRIES * HID_REPORT_DESC_ENTRY_SIZE) + 8)
 #define HID_REPORT_DESCRIPTOR_SIZE_LE (((HID_REPORT_DESCRIPTOR_SIZE >> 8) & 0xff) | \
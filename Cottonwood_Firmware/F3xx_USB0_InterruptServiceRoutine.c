@@ -42,6 +42,7 @@
 #include "F3xx_USB0_InterruptServiceRoutine.h"
 #include "F3xx_USB0_Descriptor.h"
 #include "F3xx_USB0_ReportHandler.h"
+#include "trace.h"
 
 /*----------------------------------------------------------------------------- */
 /* Global Variable Definitions */
@@ -591,6 +592,7 @@ void SendPacket (unsigned char ReportID)
 
     /* Guarantee sequential stream compatible to UART implementation */
     IN_BUFFER.Ptr[1] = IN_BUFFER.Length;
+    TRACE_EVENT(TRACE_USB_SEND, IN_BUFFER.Ptr[0]);
 
     if (EP_STATUS[1] == EP_TX)        /* If endpoint is currently transmitting, */
     {
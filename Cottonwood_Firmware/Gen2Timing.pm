@@ -0,0 +1,162 @@
+#
+# Gen2 link timing model for the profiles of gen2Configure().
+#
+# All times are in seconds. A profile is created from the same settings as
+# struct gen2Config (link frequency, coding, trext, tari), which determine
+# BLF, divide ratio and TRcal exactly as gen2Configure() programs them.
+# Command and reply durations follow the Gen2 air interface definitions,
+# data-1 is assumed to be 2 tari long (the AS399x default).
+#
+# Used by gen2budget.pl.
+#
+package Gen2Timing;
+
+use strict;
+use warnings;
+
+# GEN2_LF_* -> kHz
+our %LF = (0 => 40, 3 => 80, 6 => 160, 8 => 213.33, 9 => 256, 12 => 320, 15 => 640);
+# GEN2_COD_* -> M
+our %MILLER = (0 => 1, 1 => 2, 2 => 4, 3 => 8);
+# tari setting -> s
+our %TARI = (0 => 6.25e-6, 1 => 12.5e-6, 2 => 25e-6);
+
+# command lengths in bits, without preamble/frame-sync
+our %CMD = (query => 22, queryrep => 4, queryadjust => 9, ack => 18, nak => 8, reqrn => 40);
+
+#--------------------------------------------------------------------------
+# new(lf => GEN2_LF_*, miller => GEN2_COD_*, trext => 0/1, tari => 0..2, epc => bytes)
+sub new
+{
+    my ($class, %a) = @_;
+    my $lf    = $a{lf}     // 12;
+    my $cod   = $a{miller} // 2;
+    my $tcode = $a{tari}   // 2;
+    die "unknown link frequency setting $lf\n" unless (exists $LF{$lf});
+    die "unknown coding $cod\n" unless (exists $MILLER{$cod});
+    die "unknown tari setting $tcode\n" unless (exists $TARI{$tcode});
+
+    my $s = bless {
+        lf    => $lf,
+        blf   => $LF{$lf} * 1e3,
+        m     => $MILLER{$cod},
+        tari  => $TARI{$tcode},
+        trext => ($cod == 0) ? 1 : ($a{trext} // 0),   # gen2Configure() forces trext for FM0
+        epc   => $a{epc} // 12,
+    }, $class;
+
+    # divide ratio as selected in gen2Configure()
+    my $dr0 = ($lf == 0 || $lf == 3)
+           || ($tcode == 0 && ($lf == 8 || $lf == 9 || $lf == 12))
+           || ($tcode == 1 && $lf == 6);
+    $s->{dr}    = $dr0 ? 8 : 64 / 3;
+    $s->{trcal} = $s->{dr} / $s->{blf};
+    $s->{rtcal} = 3 * $s->{tari};
+    $s->{tpri}  = 1 / $s->{blf};
+    $s->{t1}    = ($s->{rtcal} > 10 * $s->{tpri}) ? $s->{rtcal} : 10 * $s->{tpri};
+    $s->{t2}    = 3 * $s->{tpri};
+    $s->{t4}    = 2 * $s->{rtcal};
+    return $s;
+}
+
+sub name
+{
+    my ($s) = @_;
+    return sprintf("LF %gkHz %s tari %.2fus%s", $s->{blf} / 1e3,
+        $s->{m} == 1 ? "FM0" : "M$s->{m}", $s->{tari} * 1e6, $s->{trext} ? " TRext" : "");
+}
+
+# reader command of bits length, query adds TRcal to the preamble
+sub command
+{
+    my ($s, $bits, $query) = @_;
+    my $frameSync = 12.5e-6 + $s->{tari} + $s->{rtcal};
+    return $frameSync + ($query ? $s->{trcal} : 0) + $bits * 1.5 * $s->{tari};
+}
+
+# tag reply of bits length including preamble and end of signaling
+sub reply
+{
+    my ($s, $bits) = @_;
+    my $pre = ($s->{m} == 1) ? 6 + ($s->{trext} ? 12 : 0) : 6 + ($s->{trext} ? 16 : 4);
+    return ($pre + $bits + 1) * $s->{m} * $s->{tpri};
+}
+
+#--------------------------------------------------------------------------
+# durations of one slot, overhead is the firmware time per slot
+sub slotEmpty
+{
+    my ($s, $overhead) = @_;
+    # no reply is detected after T1 plus the preamble
+    return $s->command($CMD{queryrep}) + $s->{t1} + $s->reply(0) + ($overhead // 0);
+}
+
+sub slotCollision
+{
+    my ($s, $overhead) = @_;
+    return $s->command($CMD{queryrep}) + $s->{t1} + $s->reply(16) + $s->{t2} + ($overhead // 0);
+}
+
+sub slotSingle
+{
+    my ($s, $overhead) = @_;
+    my $epcBits = 16 + 8 * $s->{epc} + 16;
+    return $s->command($CMD{queryrep}) + $s->{t1} + $s->reply(16) + $s->{t2}
+         + $s->command($CMD{ack}) + $s->{t1} + $s->reply($epcBits) + $s->{t2} + ($overhead // 0);
+}
+
+# Req_RN plus handle reply, e.g. before each access
+sub reqRN
+{
+    my ($s) = @_;
+    return $s->command($CMD{reqrn}) + $s->{t1} + $s->reply(32) + $s->{t2};
+}
+
+# Read of words words incl. Req_RN
+sub read
+{
+    my ($s, $words) = @_;
+    return $s->reqRN() + $s->command(8 + 2 + 8 + 8 + 16 + 16) + $s->{t1}
+         + $s->reply(1 + 16 * $words + 16 + 16) + $s->{t2};
+}
+
+#--------------------------------------------------------------------------
+# Expected inventory round with n tags in field and a fixed q, each tag
+# replying once in a uniformly chosen slot (framed slotted aloha).
+# Returns (singulated tags, round duration).
+sub round
+{
+    my ($s, $n, $q, $overhead) = @_;
+    my $l = 2 ** $q;
+    my $p0 = (1 - 1 / $l) ** $n;
+    my $p1 = $n / $l * (1 - 1 / $l) ** ($n - 1);
+    my $pc = 1 - $p0 - $p1;
+    $pc = 0 if ($pc < 0);
+    my $time = $s->command($CMD{query}, 1) - $s->command($CMD{queryrep})
+             + $l * ($p0 * $s->slotEmpty($overhead) + $p1 * $s->slotSingle($overhead)
+                     + $pc * $s->slotCollision($overhead));
+    return ($l * $p1, $time);
+}
+
+# tags per second for n tags with fixed q
+sub throughput
+{
+    my ($s, $n, $q, $overhead) = @_;
+    my ($tags, $time) = $s->round($n, $q, $overhead);
+    return $tags / $time;
+}
+
+# best q for n tags, returns (q, tags per second)
+sub bestQ
+{
+    my ($s, $n, $overhead) = @_;
+    my ($bq, $best) = (0, 0);
+    for my $q (0 .. 15)
+    {
+        my $t = $s->throughput($n, $q, $overhead);
+        ($bq, $best) = ($q, $t) if ($t > $best);
+    }
+    return ($bq, $best);
+}
+
+1;
@@ -39,12 +39,11 @@
 #include "as399x_com.h"
 #include "uart.h"
 #include "timer.h"
+#include "sched.h"
+#include "bench.h"
 #include "gen2.h"
 #include "stdlib.h"
 #include "string.h"
-#if VERBOSE_INIT
-#include <math.h>
-#endif
 
 /** Definition protocol read bit. */
 #define READ                      0x40
@@ -86,6 +85,8 @@ u32 as399xCurrentBaseFreq;
 static u8 as399xSavedSensRegs[2];
 static u8 as399xPowerDownRegs[AS399X_REG_ADC];
 static u8 as399xPowerDownRegs3[5][3]; /* 5 registers are 3 bytes deep */
+/** Duration of the last as399xExitPowerDownMode() in us and number of wake ups */
+static u16 as399xWakeLatency, as399xWakeCount;
 
 
 /** Is set to 1 in as399xAntennaPower if output power is on. In as399xCyclicPowerRegulation()
@@ -147,7 +148,7 @@ static void as399xPrintRfpLine(void)
         val = as399xGetReflectedPower( );
         ch_val_i = (s8)((val&0xff) - (noiseval&0xff));
         ch_val_q = (s8)(((val>>8)&0xff) - ((noiseval>>8)&0xff));
-        rf = sqrt(ch_val_i * ch_val_i + ch_val_q * ch_val_q);
+        rf = squareRoot((u16)(ch_val_i * ch_val_i) + (u16)(ch_val_q * ch_val_q));
         CON_print("rf=%hx ",rf);
 
         CON_print("%hx", val);
@@ -530,6 +531,7 @@ u16 as399xInitialize(u32 baseFreq)
 void extInt(void) interrupt 0
 {
     u8 DATA istat, istat2;
+    BENCH_BEGIN(BENCH_EXTINT);
     as399xIrqStatus = as399xSingleReadIrq(AS399X_REG_IRQSTATUS);
     istat2 = as399xSingleReadIrq(AS399X_REG_IRQSTATUS);
     as399xFifoStatus = 0;
@@ -558,6 +560,7 @@ void extInt(void) interrupt 0
 
     as399xResponse |= istat | (as399xFifoStatus << 8 );
     //CON_print("isr %hx", as399xResponse);
+    BENCH_END(BENCH_EXTINT);
 }
 
 /* The following functions could be used to push the spi communication out of the ISR. But this is a little
@@ -783,6 +786,7 @@ void as399xWaitForResponse(u16 waitMaskOrig)
     {
         if ((as399xResponse & waitMask) != 0)
             break;
+        BUSYWAIT();
     }
     if (counter > 0xFFF0)
     {
@@ -916,7 +920,7 @@ static void as399xLockPLL(void)
                 as399xContinuousWrite(AS399X_REG_CLSYSAOCPCTRL, buf, 3);
                 buf[1] |= 0x80;   /* set the auto Bit */
                 as399xContinuousWrite(AS399X_REG_CLSYSAOCPCTRL, buf, 3);
-                mdelay(10);  /* Please keep in mind, that the Auto Bit procedure will take app. 6 ms whereby the locktime of PLL is just 400us */
+                schedWait_ms(10);  /* Please keep in mind, that the Auto Bit procedure will take app. 6 ms whereby the locktime of PLL is just 400us */
                 var=as399xSingleRead(AS399X_REG_AGCINTERNALSTATUS);
             } while ( (var & 0x02)==0 && (i<3));/* wait for PLL to be locked and give a few attempts */
         }
@@ -1115,9 +1119,9 @@ void as399xAntennaPower( u8 on )
 
     if(on) /* according to standard we have to wait 1.5ms before issuing commands  */
 #if ROLAND
-        mdelay(6);          // MOT wants to have higher dwell time
+        schedWait_ms(6);    // MOT wants to have higher dwell time
 #else
-        mdelay(1.5);        //TODO: define dwell time via GUI
+        udelay(1500);       //TODO: define dwell time via GUI
 #endif
 }
 
@@ -1128,10 +1132,10 @@ static u8 as399xGetRawRSSI( void )
     as399xSingleCommand(AS399X_CMD_BLOCKRX);
     as399xSingleCommand(AS399X_CMD_ENABLERX);
 #if RUN_ON_AS3992
-    udelay(500); /* According to architecture note we have to wait here at least 100us
+    schedWait_us(500); /* According to architecture note we have to wait here at least 100us
                     however experiments show 350us to be necessary on AS3992 */
 #else
-    udelay(100); /* According to architecture note we have to wait here at least 100us */
+    schedWait_us(100); /* According to architecture note we have to wait here at least 100us */
 #endif
     value = as399xSingleRead(AS399X_REG_RSSILEVELS);
     as399xSingleCommand(AS399X_CMD_BLOCKRX);
@@ -1331,7 +1335,7 @@ void as399xGetRSSI( u16 num_of_ms_to_scan, u8 *rawIQ, s8* dBm )
 #else
     as399xSingleWrite(AS399X_REG_RXSPECIAL, 0x01 ); /* Optimal filter settings */
 #endif
-    if(!(valstat & 0x02)) mdelay(10); /* rec_on needs about 6ms settling time, to be sure wait 10 ms */
+    if(!(valstat & 0x02)) schedWait_ms(10); /* rec_on needs about 6ms settling time, to be sure wait 10 ms */
 
     sum = 0;
     while (num_of_reads--)
@@ -1393,7 +1397,7 @@ void as399xGetRSSI( u16 num_of_ms_to_scan, u8 *rawIQ, s8* dBm )
 end:
     as399xSingleWrite(AS399X_REG_RXSPECIAL, regFilter ); /* Restore filter */
     as399xSingleWrite(AS399X_REG_STATUSCTRL,valstat);
-    if(valstat & 1) mdelay(6); /* according to standard we have to wait 1.5ms before issuing commands  */
+    if(valstat & 1) schedWait_ms(6); /* according to standard we have to wait 1.5ms before issuing commands  */
     return;
 }
 /* ADC Values are in sign magnitude representation -> convert */
@@ -1808,7 +1812,10 @@ void as399xEnterPowerDownMode()
     /* Switch off antenna */
     as399xPowerDownRegs[0] = as399xSingleRead(0);
     as399xSingleWrite(0, as399xPowerDownRegs[0] & (~0x03));
-    for (i=1;i<AS399X_REG_ADC;i++)
+    /* Snapshot in bursts, the three bytes deep registers are read on their own */
+    as399xContinuousRead(AS399X_REG_PROTOCOLCTRL, AS399X_REG_TESTSETTING - AS399X_REG_PROTOCOLCTRL,
+                         &as399xPowerDownRegs[AS399X_REG_PROTOCOLCTRL]);
+    for (i = AS399X_REG_TESTSETTING; i < AS399X_REG_ADC; i++)
     {
         if(  i==AS399X_REG_TESTSETTING   || i==AS399X_REG_CLSYSAOCPCTRL 
           || i==AS399X_REG_MODULATORCTRL || i==AS399X_REG_PLLMAIN 
@@ -1833,6 +1840,8 @@ void as399xExitPowerDownMode()
 {
     u8 i;
     u8 reg3cnt = 0;
+    struct timerStopwatch sw;
+    u32 latency;
 
 #if ROLAND
     if (P4 & 0x02) return;
@@ -1840,12 +1849,15 @@ void as399xExitPowerDownMode()
     if (ENABLE) return;
 #endif
 
+    timerStopwatchStart(&sw);
     EN(HIGH);
-    mdelay(12);  /* AS3992 needs 12 ms to exit standby */
+    schedWait_ms(12);  /* AS3992 needs 12 ms to exit standby */
     reg3cnt = 0;
     /* Do not switch on antenna before PLL is locked.*/
     as399xSingleWrite(0, as399xPowerDownRegs[0] & (~0x03));
-    for (i=1;i<AS399X_REG_ADC;i++)
+    as399xContinuousWrite(AS399X_REG_PROTOCOLCTRL, &as399xPowerDownRegs[AS399X_REG_PROTOCOLCTRL],
+                          AS399X_REG_TESTSETTING - AS399X_REG_PROTOCOLCTRL);
+    for (i = AS399X_REG_TESTSETTING; i < AS399X_REG_ADC; i++)
     {
         if(  i==AS399X_REG_TESTSETTING   || i==AS399X_REG_CLSYSAOCPCTRL 
           || i==AS399X_REG_MODULATORCTRL || i==AS399X_REG_PLLMAIN 
@@ -1861,5 +1873,13 @@ void as399xExitPowerDownMode()
     udelay(300);        /* without delay pll locking might fail --> spurs in spectrum */
     as399xLockPLL();
     as399xSingleWrite(0, as399xPowerDownRegs[0]);
+    latency = timerStopwatch_us(&sw);
+    as399xWakeLatency = (latency > 0xffff) ? 0xffff : latency;
+    as399xWakeCount++;
+}
 
+void as399xGetWakeStats(u16 *latency, u16 *count)
+{
+    *latency = as399xWakeLatency;
+    *count = as399xWakeCount;
 }
@@ -408,7 +408,7 @@ void as399xExitStandbyMode();
 /*!
  *****************************************************************************
  *  \brief  Enter the power down mode by setting EN pin to low, saving 
- *  registers beforehand
+ *  registers beforehand. Registers 0x01 .. 0x11 are read in one burst.
  *
  *****************************************************************************
  */
@@ -417,12 +417,22 @@ void as399xEnterPowerDownMode();
 /*!
  *****************************************************************************
  *  \brief  Exit the power down mode by setting EN pin to high, restoring 
- *  registers afterwards.
+ *  registers afterwards. Registers 0x01 .. 0x11 are written in one burst.
  *
  *****************************************************************************
  */
 void as399xExitPowerDownMode();
 
+/*!
+ *****************************************************************************
+ *  \brief  Returns the duration of the last wake up from power down mode
+ *  (as399xExitPowerDownMode()) in us until the PLL is locked again, and the
+ *  number of wake ups since reset.
+ *
+ *****************************************************************************
+ */
+void as399xGetWakeStats(u16 *latency, u16 *count);
+
 /*!
  *****************************************************************************
  * Sets DAC output voltage according to parameter natVal. The DAC values of AS399x
@@ -61,8 +61,18 @@
 /** Define this to 1 if AS3992 should be supported, software will cease to run on AS3990/1 */
 #define RUN_ON_AS3992 1
 
+/** Set to 1 by host/Makefile for the gcc build against a simulated AS399x,
+  see host/as399xsim.c. The commands are then exposed over a pseudo terminal. */
+#ifndef HOSTSIM
+#define HOSTSIM 0
+#endif
+
 /** Define this to 1 if UART should be used for communicating with host */
+#if HOSTSIM
+#define UARTSUPPORT    1
+#else
 #define UARTSUPPORT    0
+#endif
 
 /** Define this to 1 if as399xInitialize() should perform a proper selftest, 
   testing connection AS399x, crystal, pll, antenna */
@@ -76,6 +86,31 @@
 /** Set this to 1 to enable iso6b support */
 #define ISO6B 1
 
+/** Set this to 1 to record hot path events into the trace buffer, see trace.h */
+#define TRACE 0
+
+/** Set this to 1 to additionally record every AS399x bus transaction into
+  the trace buffer, requires TRACE, see busreplay.pl */
+#define BUSREC 0
+
+/** Set this to 1 to let CON_print() send the format string address and the raw
+  arguments instead of formatted text, use binlog2txt.pl to decode the output */
+#define BINLOG 0
+
+/** Set this to 1 to count the SYSCLK cycles spent in the hot paths, see bench.h.
+  make -C host bench sets it for the host build. */
+#ifndef BENCH
+#define BENCH 0
+#endif
+
+/** Set this to 1 to support an EPC watchlist stored as Bloom filter in flash,
+  see watchlist.h and callWatchlist() */
+#define WATCHLIST 0
+
+/** Set this to 1 to cache the data read from tags in XDATA, see tagcache.h
+  and callTagCache(). Takes about 200 bytes of XDATA with the default sizes. */
+#define TAGCACHE 0
+
 /** Set to one if an antenna tuner is available */
 #if ROLAND || ARNIE
 #define CONFIG_TUNER   1
@@ -105,8 +140,13 @@ typedef unsigned char u8;
 typedef signed char s8;
 typedef unsigned short u16;
 typedef signed short s16;
+#if HOSTSIM
+typedef unsigned int u32; /* long has 64 bit on the host */
+typedef signed int s32;
+#else
 typedef unsigned long u32;
 typedef signed long s32;
+#endif
 /** USE WITH CARE!!! unsigned machine word : 8 bit on 8bit machines, 16 bit on 16 bit machines... */
 typedef unsigned char umword;
 /** USE WITH CARE!!! signed machine word : 8 bit on 8bit machines, 16 bit on 16 bit machines... */
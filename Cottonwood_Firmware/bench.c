@@ -0,0 +1,73 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Implementation of the hot path cycle counters, see bench.h
+  */
+#include "c8051F340.h"
+#include "as399x_config.h"
+#include "global.h"
+#include "bench.h"
+#include "string.h"
+
+#if BENCH
+XDATA u32 benchStart_[BENCH_NUM];
+XDATA struct benchCounter benchCounter_[BENCH_NUM];
+u8 benchOverhead_;
+
+void benchInit(void)
+{
+    u32 a, b;
+
+    BENCH_READ(a);
+    BENCH_READ(b);
+    benchOverhead_ = (b - a) & 0xff;
+    benchClear();
+}
+
+void benchGet(u8 id, u8 *dest)
+{
+    struct benchCounter XDATA *c = &benchCounter_[id];
+
+    u16ToBuffer(c->count, dest);
+    u32ToBuffer(c->cycles, dest + 2);
+    u32ToBuffer(c->max, dest + 6);
+}
+
+void benchClear(void)
+{
+    memset(benchCounter_, 0, sizeof(benchCounter_));
+}
+#else
+void benchInit(void)
+{
+}
+
+void benchGet(u8 id, u8 *dest)
+{
+    (void)id;
+    memset(dest, 0, BENCH_ENTRY_SIZE);
+}
+
+void benchClear(void)
+{
+}
+#endif
@@ -0,0 +1,97 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief This file is the include file for the bench.c file.
+  *
+  * If #BENCH is set in as399x_config.h the SYSCLK cycles spent in the hot
+  * paths are accumulated: one counter per singulated tag, per external
+  * interrupt, per inventory round and per inventory report. The cycle clock
+  * is built from the free running timer0 and PCA (see timerInit()), has a
+  * resolution of one SYSCLK cycle and wraps after 2^32 cycles (~89s), far
+  * beyond the longest inventory round.
+  * The time needed to read the clock is measured in benchInit() and
+  * subtracted. The counters are read out with callBench(), bench.pl
+  * compares them against a stored baseline.
+  * If #BENCH is 0 BENCH_BEGIN() and BENCH_END() generate no code.
+  */
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include "c8051F340.h"
+#include "as399x_config.h"
+#include "global.h"
+
+/* Counter ids */
+#define BENCH_TAG               0   /**< gen2StoreTagIDFast() of a singulated tag */
+#define BENCH_EXTINT            1   /**< extInt() */
+#define BENCH_ROUND             2   /**< one gen2SearchForTagsFast() round */
+#define BENCH_REPORT            3   /**< preparing one inventory report */
+#define BENCH_NUM               4
+
+/** Number of bytes per counter in benchGet(): count (u16), cycles (u32), max (u32), LSB first */
+#define BENCH_ENTRY_SIZE        10
+
+#if BENCH
+struct benchCounter
+{
+    u32 cycles;
+    u32 max;
+    u16 count;
+};
+
+extern XDATA u32 benchStart_[BENCH_NUM];
+extern XDATA struct benchCounter benchCounter_[BENCH_NUM];
+extern u8 benchOverhead_;
+
+/** Reads the 32 bit cycle clock into v. Implemented as macro to be usable
+  in interrupt context without reentrancy problems. */
+#define BENCH_READ(v) do { u8 x_, h_, m_, l_;                             \
+        do { x_ = PCA0H; h_ = PCA0L; m_ = TH0; l_ = TL0; }                \
+        while (x_ != PCA0H || h_ != PCA0L || m_ != TH0);                  \
+        (v) = ((u32)x_ << 24) | ((u32)h_ << 16) | ((u16)m_ << 8) | l_; } while (0)
+
+/** Starts measurement of counter id */
+#define BENCH_BEGIN(id) BENCH_READ(benchStart_[id])
+
+/** Adds the cycles since BENCH_BEGIN(id) to counter id */
+#define BENCH_END(id) do { u32 c_;                                          \
+        BENCH_READ(c_);                                                     \
+        c_ = c_ - benchStart_[id] - benchOverhead_;                          \
+        benchCounter_[id].cycles += c_;                                     \
+        benchCounter_[id].count++;                                          \
+        if (c_ > benchCounter_[id].max) benchCounter_[id].max = c_; } while (0)
+#else
+#define BENCH_BEGIN(id)
+#define BENCH_END(id)
+#endif
+
+/** Calibrates the clock overhead and clears all counters, call after timerInit() */
+void benchInit(void);
+
+/** Copies counter id as BENCH_ENTRY_SIZE bytes to dest, all 0 if #BENCH is not set */
+void benchGet(u8 id, u8 *dest);
+
+/** Clears all counters */
+void benchClear(void);
+
+#endif
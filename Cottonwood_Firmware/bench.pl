@@ -0,0 +1,87 @@
+#!/usr/bin/perl
+#
+# Evaluates the hot path cycle counters of a firmware built with BENCH set
+# in as399x_config.h (report 0x6A, see callBench() in usb_commands.c).
+#
+# make -C host bench runs it on the host build against host/bench.baseline.
+# There the cycles are those of the virtual clock, i.e. the modelled AS399x
+# bus transfers, air time and register polls, not the 8051 instructions, so
+# it catches protocol and wait regressions; the target numbers stay the
+# reference for the code itself.
+#
+# Input is the report as hex bytes, e.g.
+#   6a 2b 04 10 00 ...
+# Lines not starting with 6a are ignored, the last report found is used.
+#
+# usage: bench.pl [-s baseline.txt] [-b baseline.txt] [-t percent] report.txt
+#   -s  save the averages as new baseline
+#   -b  compare against baseline, exit code 1 if any average grew by more
+#       than percent (default 5)
+#
+use strict;
+use warnings;
+use Getopt::Std;
+
+my %opt;
+getopts('s:b:t:', \%opt) or die "usage: $0 [-s file] [-b file] [-t percent] report.txt\n";
+my $threshold = $opt{t} // 5;
+
+my $CLK = 48000000;
+my @names = ("tag", "extInt", "round", "report");
+
+my @report;
+while (my $line = <>)
+{
+    $line =~ s/^\s+//;
+    my @b = map { hex } split /[\s,]+/, $line;
+    @report = @b if (@b >= 3 && $b[0] == 0x6a);
+}
+die "no bench report found\n" unless (@report);
+die "benchmarking not compiled in, set BENCH in as399x_config.h\n" unless ($report[2]);
+
+sub getLE
+{
+    my ($off, $len) = @_;
+    my $v = 0;
+    $v |= $report[$off + $_] << (8 * $_) for (0 .. $len - 1);
+    return $v;
+}
+
+my %avg;
+printf "%-8s %8s %12s %10s %10s %10s\n", "counter", "count", "cycles", "avg", "max", "avg us";
+for (my $i = 0; $i < $report[2]; $i++)
+{
+    my $o = 3 + 10 * $i;
+    my ($count, $cycles, $max) = (getLE($o, 2), getLE($o + 2, 4), getLE($o + 6, 4));
+    my $name = $names[$i] // "c$i";
+    my $a = $count ? $cycles / $count : 0;
+    $avg{$name} = $a;
+    printf "%-8s %8d %12d %10.0f %10d %10.1f\n", $name, $count, $cycles, $a, $max, $a * 1e6 / $CLK;
+}
+
+my $regression = 0;
+if ($opt{b})
+{
+    open(my $fh, '<', $opt{b}) or die "$opt{b}: $!\n";
+    while (<$fh>)
+    {
+        my ($name, $base) = split;
+        next unless (defined $base && exists $avg{$name} && $base > 0 && $avg{$name} > 0);
+        my $diff = ($avg{$name} - $base) * 100 / $base;
+        if ($diff > $threshold)
+        {
+            printf "REGRESSION %-8s %10.0f -> %10.0f cycles (%+.1f%%)\n", $name, $base, $avg{$name}, $diff;
+            $regression = 1;
+        }
+    }
+    close($fh);
+}
+
+if ($opt{s})
+{
+    open(my $fh, '>', $opt{s}) or die "$opt{s}: $!\n";
+    printf $fh "%s %.0f\n", $_, $avg{$_} foreach (sort keys %avg);
+    close($fh);
+}
+
+exit $regression;
@@ -0,0 +1,141 @@
+#!/usr/bin/perl
+#
+# Decodes the output of a firmware built with BINLOG set in as399x_config.h.
+# CON_print() then sends only the code address of its format string and the
+# raw arguments, the format strings themselves are read here from the hex
+# file of the very same build.
+#
+# Frame layout (see uart.c):
+#   0xA5, format address MSB, format address LSB, arguments MSB first
+#   0xA5, 0x00, 0x00, length, data           for CON_hexdump()
+#
+# usage: binlog2txt.pl Cottonwood.hex capture.bin
+#
+use strict;
+use warnings;
+
+die "usage: $0 firmware.hex capture.bin\n" unless (@ARGV == 2);
+my ($hexfile, $capfile) = @ARGV;
+
+my $SYNC = 0xA5;
+
+# read the code image
+my %mem;
+my $upper = 0;
+open(my $hex, '<', $hexfile) or die "$hexfile: $!\n";
+while (my $line = <$hex>)
+{
+    next unless ($line =~ /^:([0-9A-Fa-f]+)/);
+    my @b = map { hex } unpack("(A2)*", $1);
+    my ($len, $addr, $type) = ($b[0], ($b[1] << 8) | $b[2], $b[3]);
+    if ($type == 0)
+    {
+        $mem{$upper + $addr + $_} = $b[4 + $_] for (0 .. $len - 1);
+    }
+    elsif ($type == 4)
+    {
+        $upper = (($b[4] << 8) | $b[5]) << 16;
+    }
+}
+close($hex);
+
+sub codeString
+{
+    my ($addr) = @_;
+    my $s = "";
+    while (defined $mem{$addr} && $mem{$addr} != 0)
+    {
+        $s .= chr($mem{$addr++});
+    }
+    return defined $mem{$addr} ? $s : undef;
+}
+
+open(my $cap, '<:raw', $capfile) or die "$capfile: $!\n";
+my @in = unpack("C*", do { local $/; <$cap> });
+close($cap);
+
+my $pos = 0;
+sub next_byte
+{
+    die "capture truncated\n" if ($pos > $#in);
+    return $in[$pos++];
+}
+
+# formats one message the same way CON_print() does on the target
+sub format_message
+{
+    my ($fmt) = @_;
+    my $out = "";
+    my @f = split //, $fmt;
+    for (my $i = 0; $i < @f; $i++)
+    {
+        my $c = $f[$i];
+        if ($c ne '%')
+        {
+            $out .= ($c eq "\n") ? "\r\n" : $c;
+            next;
+        }
+        my ($hs, $width) = (0, 0);
+        while (++$i < @f)
+        {
+            $c = $f[$i];
+            if ($c eq '%') { $out .= '%'; last; }
+            elsif ($c eq 'h') { $hs++; }
+            elsif ($c =~ /[0-9]/) { $width = $c if ($c ne '0'); }
+            elsif ($c =~ /[XclDUdux]/)
+            {
+                my $val;
+                my $nibbles = 4;
+                if ($hs == 2)
+                {
+                    $val = next_byte();
+                    $nibbles = 2;
+                }
+                else
+                {
+                    $val = (next_byte() << 8) | next_byte();
+                }
+                my $digits = sprintf($c eq 'X' ? "%X" : "%x", $val);
+                $width = $nibbles unless ($width);
+                $out .= ("0" x ($width - length($digits))) . $digits;
+                last;
+            }
+        }
+    }
+    return $out;
+}
+
+while ($pos <= $#in)
+{
+    my $b = $in[$pos++];
+    if ($b != $SYNC)
+    {
+        printf STDERR "skipping 0x%02x at %d\n", $b, $pos - 1;
+        next;
+    }
+    my $start = $pos - 1;
+    my $addr = eval { (next_byte() << 8) | next_byte() };
+    last unless (defined $addr);
+    if ($addr == 0)
+    {
+        my $len = eval { next_byte() };
+        last unless (defined $len);
+        my @data = eval { map { next_byte() } (1 .. $len) };
+        last if ($@);
+        for (my $i = 0; $i < @data; $i += 8)
+        {
+            my $end = ($i + 7 > $#data) ? $#data : $i + 7;
+            print join(" ", map { sprintf("%02x", $_) } @data[$i .. $end]), "\r\n";
+        }
+        next;
+    }
+    my $fmt = codeString($addr);
+    unless (defined $fmt)
+    {
+        printf STDERR "no format string at 0x%04x (offset %d)\n", $addr, $start;
+        next;
+    }
+    my $msg = eval { format_message($fmt) };
+    last unless (defined $msg);
+    print $msg;
+}
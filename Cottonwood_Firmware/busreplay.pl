@@ -0,0 +1,153 @@
+#!/usr/bin/perl
+#
+# Counts AS399x bus transactions and bytes per high level operation from
+# trace buffer dumps of a firmware built with TRACE and BUSREC set in
+# as399x_config.h (reports 0x68, see callTraceDump() and trace.h).
+#
+# Arm the recorder with trace dump clear = 2 (one shot), run the scenario,
+# then dump. Several dumps may be concatenated into one input file.
+#
+# Bus traffic is attributed to the operation started by the last marker:
+#   slot   Query or QueryRep slot (TRACE_QUERY, TRACE_SLOT)
+#   tag    slots which delivered a valid EPC (TRACE_EPC with arg 1)
+#   read   gen2ReadFromTag() (TRACE_READ)
+#   hop    frequency hop incl. listen before talk (TRACE_LBT_BEGIN)
+#   usb    report sending (TRACE_USB_SEND)
+#
+# usage: busreplay.pl [-s golden.txt] [-g golden.txt] dump.txt
+#   -s  save the averages per operation as golden counts
+#   -g  compare against golden counts, exit code 1 if an operation uses
+#       more transactions or bytes than recorded there
+#
+# No golden files are shipped with the sources, they depend on the reader
+# hardware and the tags in the field and have to be recorded with -s on the
+# setup used for the comparison. -g fails with exit code 2 if the golden
+# file is missing or has no counts for an operation found in the dump.
+#
+use strict;
+use warnings;
+use Getopt::Std;
+
+my %opt;
+getopts('s:g:', \%opt) or die "usage: $0 [-s golden.txt] [-g golden.txt] dump.txt\n";
+
+# golden counts: op => [ transactions, bytes ], read first to fail early
+my %golden;
+if ($opt{g})
+{
+    open(my $fh, '<', $opt{g}) or do
+    {
+        print STDERR "golden file $opt{g}: $!, record one with -s first\n";
+        exit 2;
+    };
+    while (<$fh>)
+    {
+        my ($n, $tr, $by) = split;
+        $golden{$n} = [ $tr, $by ] if (defined $by);
+    }
+    close($fh);
+}
+
+my @entries;
+while (my $line = <>)
+{
+    $line =~ s/^\s+//;
+    my @b = map { hex } split /[\s,]+/, $line;
+    next if (@b < 4 || $b[0] != 0x68);
+    for (my $i = 0; $i < $b[3]; $i++)
+    {
+        my $o = 4 + 4 * $i;
+        last if ($o + 3 > $#b);
+        push @entries, [ $b[$o], $b[$o + 1] ];
+    }
+}
+die "no trace entries found\n" unless (@entries);
+
+# operation started by a marker, markers not listed here do not start a new one
+my %starts = (0x01 => "slot", 0x02 => "slot", 0x0B => "read", 0x08 => "hop", 0x0A => "usb");
+
+my %sum;        # op => [ count, transactions, bytes ]
+my $op;         # current operation: [ name, transactions, bytes, isTag ]
+my ($bus, $truncated) = (0, 0);
+
+sub finish
+{
+    return unless ($op);
+    my @names = ($op->[0]);
+    push @names, "tag" if ($op->[3]);
+    foreach my $n (@names)
+    {
+        $sum{$n}[0]++;
+        $sum{$n}[1] += $op->[1];
+        $sum{$n}[2] += $op->[2];
+    }
+    undef $op;
+}
+
+foreach my $e (@entries)
+{
+    my ($id, $arg) = @$e;
+    if ($id & 0x80)
+    {
+        $bus++;
+        $truncated++ if (($id & 0x3f) == 0x3f);
+        next unless ($op);
+        $op->[1]++;
+        $op->[2] += $id & 0x3f;
+        next;
+    }
+    if (exists $starts{$id})
+    {
+        finish();
+        $op = [ $starts{$id}, 0, 0, 0 ];
+    }
+    elsif ($id == 0x05 && $op && $arg == 1)
+    {
+        $op->[3] = 1;
+    }
+}
+# the last operation may be incomplete, it is dropped
+undef $op;
+
+die "no bus transactions found, is BUSREC set?\n" unless ($bus);
+printf "%d entries, %d bus transactions", scalar @entries, $bus;
+printf ", %d with 63 or more bytes (counted as 63)", $truncated if ($truncated);
+print "\n";
+printf "%-6s %6s %14s %14s\n", "op", "count", "transactions", "bytes";
+
+my %avg;
+foreach my $n (sort keys %sum)
+{
+    my ($count, $tr, $by) = @{$sum{$n}};
+    $avg{$n} = [ $tr / $count, $by / $count ];
+    printf "%-6s %6d %14.1f %14.1f\n", $n, $count, @{$avg{$n}};
+}
+
+my $regression = 0;
+if ($opt{g})
+{
+    foreach my $n (sort keys %avg)
+    {
+        unless (exists $golden{$n})
+        {
+            print STDERR "golden file $opt{g} has no counts for $n, record it again with -s\n";
+            exit 2;
+        }
+        my ($tr, $by) = @{$golden{$n}};
+        if ($avg{$n}[0] > $tr + 0.05 || $avg{$n}[1] > $by + 0.05)
+        {
+            printf "REGRESSION %-6s transactions %.1f -> %.1f, bytes %.1f -> %.1f\n",
+                $n, $tr, $avg{$n}[0], $by, $avg{$n}[1];
+            $regression = 1;
+        }
+    }
+}
+
+if ($opt{s})
+{
+    open(my $fh, '>', $opt{s}) or die "$opt{s}: $!\n";
+    printf $fh "%s %.1f %.1f\n", $_, @{$avg{$_}} foreach (sort keys %avg);
+    close($fh);
+}
+
+exit $regression;
@@ -76,10 +76,16 @@ static CODE const u16 crc16OffsetTable[256]= {
 
 u16 calcCrc16(const void *buf, s16 len)
 {
+    return updateCrc16(CRC16_PRELOAD, buf, len);
+}
+
+/* continues a CRC over data received in pieces, start with CRC16_PRELOAD */
+u16 updateCrc16(u16 crc, const void *buf, s16 len)
+{
+    const u8 *p = buf;
     s16 counter;
-    u16 crc = CRC16_PRELOAD;
     for ( counter = 0; counter < len; counter++)
-        crc = (crc<<8) ^ crc16OffsetTable[((crc>>8) ^ *((s8 *)buf)++)&0x00FF];
+        crc = (crc<<8) ^ crc16OffsetTable[((crc>>8) ^ *p++)&0x00FF];
     return crc;
 }
 
@@ -46,5 +46,6 @@
 #define CRC16_PRELOAD 0xffff  /*!< specifies the initial value for the crc register */
 
 u16 calcCrc16(const void *buf, s16 len);
+u16 updateCrc16(u16 crc, const void *buf, s16 len);
 
 #endif /* CRC_H */
@@ -0,0 +1,290 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Implementation of the bulk encoding job for commissioning lines.
+  *
+  * See encoder.h for a description of the job. Frequency hopping and channel
+  * release are done using the functions provided by usb_commands.c, like the
+  * macro engine does.
+  */
+#include "c8051F340.h"
+#include "as399x_config.h"
+#include "as399x_public.h"
+#include "global.h"
+#include "gen2.h"
+#include "uart.h"
+#include "F3xx_Blink_Control.h"
+#include "F3xx_USB0_ReportHandler.h"
+#include "F3xx_USB0_InterruptServiceRoutine.h"
+#include "usb_commands.h"
+#include "encoder.h"
+#include "tagcache.h"
+#include "string.h"
+
+#define ENCODERDEBUG 0
+
+/** q used to singulate a blank tag */
+#define ENCODER_Q               2
+/** Tags encoded at most on one channel before returning to the main loop,
+  * so that the host can stop the job in between */
+#define ENCODER_TAGS_PER_HOP    8
+/** Failed attempts on the same serial number after which the job stops. A
+  * tag which cannot be encoded stays blank and would be found again forever. */
+#define ENCODER_RETRIES         3
+
+/** PC and EPC as written to the tag */
+static XDATA u8 encoderEpc_[2 + 2 * ENCODER_MAXWORDS];
+static XDATA u8 encoderBlank_[ENCODER_BLANK_SIZE];
+static XDATA u8 encoderPassword_[4];
+static XDATA u8 encoderLock_[3];
+
+static u8 encoderWords;
+static u8 encoderSerialPos;
+static u8 encoderSerialLen;
+static u8 encoderBlankLen;
+/** Words written by one BlockWrite, halved if a tag replies with an error code
+  * or does not reply */
+static u8 encoderBlockWords;
+/** Failed attempts on the current serial number */
+static u8 encoderFails;
+static u8 encoderRunning = 0;
+static u32 encoderSerial_;
+static u16 encoderIncrement;
+static u16 encoderRemaining;
+static u16 encoderEncoded_;
+
+/*------------------------------------------------------------------------- */
+/** Puts the current serial number into the EPC and the EPC length of
+  * the template into the PC, the other PC bits are kept from tag. */
+static void encoderBuild(Tag *tag)
+{
+    u32 serial = encoderSerial_;
+    u8 i;
+
+    encoderEpc_[0] = (encoderWords << 3) | (tag->pc[0] & 0x07);
+    encoderEpc_[1] = tag->pc[1];
+    for (i = encoderSerialLen; i > 0; i--)
+    {
+        encoderEpc_[2 + encoderSerialPos + i - 1] = serial & 0xff;
+        serial >>= 8;
+    }
+}
+
+/*------------------------------------------------------------------------- */
+/** Writes PC and EPC, in blocks of encoderBlockWords words. */
+static u8 encoderWrite(Tag *tag)
+{
+    u8 ptr = 0, n;
+    u8 status = GEN2_OK;
+    u8 words = encoderWords + 1;
+
+    tagcacheInvalidate(tag);
+    while (ptr < words)
+    {
+        n = words - ptr;
+        if (n > encoderBlockWords) n = encoderBlockWords;
+        if (n > 1)
+        {
+            status = gen2BlockWriteToTag(tag, MEM_EPC, 1 + ptr, n, encoderEpc_ + 2 * ptr);
+            if (status && !(status & 0x80) && status != GEN2_ERR_NOREPLY) return status;
+            if (status)
+            {   /* the tag replied with an error code or not at all, which some
+                   tags do on blocks they do not support, retry with smaller
+                   blocks, also for the following tags */
+#if ENCODERDEBUG
+                CON_print("encoder: block of %hhx failed %hhx\n", n, status);
+#endif
+                encoderBlockWords >>= 1;
+                continue;
+            }
+        }
+        else if (writeMEM(1 + ptr, tag, encoderEpc_ + 2 * ptr, 1, MEM_EPC, &status) != 1)
+        {
+            return status ? status : 0xff;
+        }
+        ptr += n;
+    }
+    return GEN2_OK;
+}
+
+/*------------------------------------------------------------------------- */
+/** Encodes the singulated tag.
+  * @return the gen2 status code, step is set to the step which failed */
+static u8 encoderTag(Tag *tag, u8 *step)
+{
+    u8 readBack[2 + 2 * ENCODER_MAXWORDS];
+    u8 status;
+
+    encoderBuild(tag);
+    *step = ENCODER_STEP_ACCESS;
+    if (encoderPassword_[0] | encoderPassword_[1] | encoderPassword_[2] | encoderPassword_[3])
+    {
+        status = gen2AccessTag(tag, encoderPassword_);
+        if (status) return status;
+    }
+    *step = ENCODER_STEP_WRITE;
+    status = encoderWrite(tag);
+    if (status) return status;
+    *step = ENCODER_STEP_VERIFY;
+    status = gen2ReadFromTag(tag, MEM_EPC, 1, encoderWords + 1, readBack);
+    if (status) return status;
+    /* the tag may compute the lower PC bits, only the length has to match */
+    if ((readBack[0] & 0xf8) != (encoderEpc_[0] & 0xf8)
+        || memcmp(readBack + 2, encoderEpc_ + 2, 2 * encoderWords))
+        return ENCODER_ERR_VERIFY;
+    *step = ENCODER_STEP_LOCK;
+    if (encoderLock_[0] | encoderLock_[1] | encoderLock_[2])
+    {
+        status = gen2LockTag(tag, encoderLock_);
+        if (status) return status;
+    }
+    *step = ENCODER_STEP_DONE;
+    return GEN2_OK;
+}
+
+/*------------------------------------------------------------------------- */
+/** Sends the result of one tag to the host.
+  The device sends:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>        1</th><th>     2</th><th>   3</th><th>4 .. 7</th><th>8 .. 9</th><th>        10</th></tr>
+    <tr><th>Content</th><td>0x78(ID)</td><td>11(length)</td><td>status</td><td>step</td><td>serial</td><td>encoded</td><td>block words</td></tr>
+  </table>
+  step is the ENCODER_STEP_* which failed, serial the serial number written
+  (or tried to), encoded the number of tags encoded so far, block words the
+  words written by one BlockWrite. If the job stops because a tag failed
+  ENCODER_RETRIES times the report of the last attempt is followed by one
+  with status ENCODER_ERR_RETRIES.
+ */
+static void encoderReport(u8 status, u8 step)
+{
+    IN_PACKET[0] = IN_ENCODER_ID;
+    IN_PACKET[1] = 11;
+    IN_PACKET[2] = status;
+    IN_PACKET[3] = step;
+    u32ToBuffer(encoderSerial_, &IN_PACKET[4]);
+    u16ToBuffer(encoderEncoded_, &IN_PACKET[8]);
+    IN_PACKET[10] = encoderBlockWords;
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_ENCODER_IDSize+1;
+    SendPacket(IN_ENCODER_ID);
+}
+
+/*------------------------------------------------------------------------- */
+u8 encoderSetup(const u8 *epc, u8 words, u8 serialPos, u8 serialLen, const u8 *blank, u8 blankLen)
+{
+    encoderStop();
+    encoderWords = 0;
+    if (words == 0 || words > ENCODER_MAXWORDS) return ENCODER_ERR_PARAM;
+    if (serialLen == 0 || serialLen > 4 || serialPos + serialLen > 2 * words) return ENCODER_ERR_PARAM;
+    if (blankLen == 0 || blankLen > ENCODER_BLANK_SIZE) return ENCODER_ERR_PARAM;
+    copyBuffer((u8*)epc, encoderEpc_ + 2, 2 * words);
+    copyBuffer((u8*)blank, encoderBlank_, blankLen);
+    encoderWords = words;
+    encoderSerialPos = serialPos;
+    encoderSerialLen = serialLen;
+    encoderBlankLen = blankLen;
+    return 0;
+}
+
+/*------------------------------------------------------------------------- */
+u8 encoderStart(u32 serial, u16 increment, u16 count, const u8 *password, const u8 *lock)
+{
+    Tag *tag = tags_;
+
+    if (encoderWords == 0) return ENCODER_ERR_PARAM;
+    encoderSerial_ = serial;
+    tag->pc[0] = 0;
+    tag->pc[1] = 0;
+    encoderBuild(tag);
+    /* an encoded tag must not be found as blank again */
+    if (encoderBlankLen <= 2 * encoderWords && !memcmp(encoderEpc_ + 2, encoderBlank_, encoderBlankLen))
+        return ENCODER_ERR_PARAM;
+    encoderIncrement = increment;
+    encoderRemaining = count;
+    encoderEncoded_ = 0;
+    encoderBlockWords = GEN2_BLOCKWRITE_MAXWORDS;
+    encoderFails = 0;
+    copyBuffer((u8*)password, encoderPassword_, 4);
+    copyBuffer((u8*)lock, encoderLock_, 3);
+    encoderRunning = 1;
+    return 0;
+}
+
+/*------------------------------------------------------------------------- */
+void encoderStop(void)
+{
+    encoderRunning = 0;
+}
+
+/*------------------------------------------------------------------------- */
+bool encoderIsRunning(void)
+{
+    return encoderRunning;
+}
+
+/*------------------------------------------------------------------------- */
+u32 encoderSerial(void)
+{
+    return encoderSerial_;
+}
+
+/*------------------------------------------------------------------------- */
+u16 encoderEncoded(void)
+{
+    return encoderEncoded_;
+}
+
+/*------------------------------------------------------------------------- */
+void encoderRun(void)
+{
+    u8 n = 0;
+    u8 status, step;
+
+    checkAndSetSession(SESSION_GEN2);
+    if (!hopFrequencies())
+    {
+        while (encoderRunning && n < ENCODER_TAGS_PER_HOP && continueCheckTimeout())
+        {
+            if (!gen2SearchForTags(tags_, 1, encoderBlank_, encoderBlankLen, ENCODER_Q, continueCheckTimeout, 1))
+                break;
+            n++;
+            status = encoderTag(tags_, &step);
+#if ENCODERDEBUG
+            CON_print("encoder: %lx step %hhx status %hhx\n", encoderSerial_, step, status);
+#endif
+            if (status == GEN2_OK) encoderEncoded_++;
+            encoderReport(status, step);
+            if (status == GEN2_OK)
+            {
+                encoderFails = 0;
+                encoderSerial_ += encoderIncrement;
+                if (encoderRemaining && --encoderRemaining == 0) encoderRunning = 0;
+            }
+            else if (++encoderFails >= ENCODER_RETRIES)
+            {
+                encoderRunning = 0;
+                encoderReport(ENCODER_ERR_RETRIES, step);
+            }
+        }
+    }
+    hopChannelRelease();
+}
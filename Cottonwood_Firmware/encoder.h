@@ -0,0 +1,114 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief This file is the include file for the encoder.c file.
+  *
+  * The encoder runs a bulk encoding job for commissioning lines autonomously
+  * from the main loop, like a macro program (see macro.h). Each new tag has
+  * an EPC matching a blank pattern, e.g. the manufacturer default. The job
+  * singulates such a tag with a Select on the blank pattern, writes PC and
+  * EPC built from a template with the current serial number, reads them back
+  * for verification and optionally locks the tag. Then the serial number is
+  * incremented. Only the result of every tag is reported to the host.
+  *
+  * PC and EPC are written with BlockWrite. If a tag replies to it with an
+  * error code or does not reply the block size is halved for this and the
+  * following tags, down to single word Writes.
+  *
+  * A tag which fails is tried again with the same serial number. After
+  * three failed attempts in a row the job stops, the last report then has
+  * status ENCODER_ERR_RETRIES.
+  */
+
+#ifndef __ENCODER_H__
+#define __ENCODER_H__
+
+#include "global.h"
+
+/** Most words of the EPC template, without PC */
+#define ENCODER_MAXWORDS        8
+/** Most bytes of the blank pattern */
+#define ENCODER_BLANK_SIZE      16
+
+/** Steps of encoding a tag as reported in the result, see encoderRun() */
+#define ENCODER_STEP_DONE       0
+#define ENCODER_STEP_ACCESS     1
+#define ENCODER_STEP_WRITE      2
+#define ENCODER_STEP_VERIFY     3
+#define ENCODER_STEP_LOCK       4
+
+/** Status if the job parameters are invalid */
+#define ENCODER_ERR_PARAM       0xF0
+/** Status if the EPC read back differs from the one written */
+#define ENCODER_ERR_VERIFY      0xF1
+/** Status of the last report if the job stopped because a tag failed repeatedly */
+#define ENCODER_ERR_RETRIES     0xF2
+
+/*------------------------------------------------------------------------- */
+/** Sets the EPC template and the blank pattern. Stops a running job.
+  * @param *epc template of the EPC, 2 * words bytes
+  * @param words EPC length in words, 1 .. ENCODER_MAXWORDS
+  * @param serialPos byte offset of the serial number in the EPC
+  * @param serialLen length of the serial number in bytes, 1 .. 4, it is
+  *        written MSB first
+  * @param *blank pattern at the start of the EPC of tags to be encoded
+  * @param blankLen length of the pattern in bytes, 1 .. ENCODER_BLANK_SIZE
+  * @return 0 on success, ENCODER_ERR_PARAM if a parameter is out of range.
+  */
+u8 encoderSetup(const u8 *epc, u8 words, u8 serialPos, u8 serialLen, const u8 *blank, u8 blankLen);
+
+/*------------------------------------------------------------------------- */
+/** Starts the job.
+  * @param serial serial number of the first tag
+  * @param increment added to the serial number after each encoded tag
+  * @param count number of tags to encode, 0 runs until encoderStop()
+  * @param *password access password, not used if 0
+  * @param *lock mask and action of a Lock after encoding as in
+  *        gen2LockTag(), no Lock if all 0
+  * @return 0 on success, ENCODER_ERR_PARAM if no template was set or the
+  *         first EPC matches the blank pattern.
+  */
+u8 encoderStart(u32 serial, u16 increment, u16 count, const u8 *password, const u8 *lock);
+
+/*------------------------------------------------------------------------- */
+/** Stops a running job. */
+void encoderStop(void);
+
+/*------------------------------------------------------------------------- */
+/** @return 1 if a job is running. */
+bool encoderIsRunning(void);
+
+/*------------------------------------------------------------------------- */
+/** @return serial number of the next tag. */
+u32 encoderSerial(void);
+
+/*------------------------------------------------------------------------- */
+/** @return number of tags encoded since encoderStart(). */
+u16 encoderEncoded(void);
+
+/*------------------------------------------------------------------------- */
+/** Hops to a channel and encodes the blank tags found there. Should be
+  * called from the main loop while encoderIsRunning() returns 1.
+  */
+void encoderRun(void);
+
+#endif
@@ -33,8 +33,14 @@
 #include "as399x_com.h"
 #include "uart.h"
 #include "timer.h"
+#include "sched.h"
+#include "trace.h"
+#include "bench.h"
 #include "gen2.h"
 #include "string.h"
+#if !UARTSUPPORT
+#include "F3xx_USB0_ReportHandler.h"
+#endif
 
 /** Definition for debug output: epc.c */
 #define EPCDEBUG          0
@@ -72,6 +78,16 @@
 
 #define GEN2_RESET_TIMEOUT 10
 
+/** Inline check of the ...Timeout variants of the inventory loops: limit slow ticks
+  * since timerStartMeasure() have not passed yet, 0 is no limit */
+#define GEN2_IN_TIME(limit) (!(limit) || timerMeasure_slowTicks() <= (limit))
+/** The host sent a command, ends the rounds of the ...OrAbort variants */
+#if UARTSUPPORT
+#define GEN2_HOST_ABORT() checkByte()
+#else
+#define GEN2_HOST_ABORT() getReceiveFlag()
+#endif
+
 /*------------------------------------------------------------------------- */
 /* local types */
 /*------------------------------------------------------------------------- */
@@ -108,6 +124,11 @@ static XDATA u8 handle_temp_[2];
 
 static XDATA struct gen2InternalConfig gen2Config;
 
+/** Statistics of the last inventory round */
+static XDATA struct gen2InventoryStats gen2Stats;
+/** Incremented with every Select and Query, see gen2GetRoundCount() */
+static u16 gen2RoundCount;
+
 /*------------------------------------------------------------------------- */
 /* local prototypes */
 /*------------------------------------------------------------------------- */
@@ -165,6 +186,7 @@ static void gen2Select(u8* mask, u8 len)
     u8 *ptr;
     u8 j,i;
     //CON_print("gen2Select() session: %hhx\n", gen2Config.config.session);
+    gen2RoundCount++;
     as399xSingleCommand(AS399X_CMD_RESETFIFO);
     as399xSingleCommand(AS399X_CMD_BLOCKRX);
     command_[0] = AS399X_CMD_RESETFIFO;
@@ -233,6 +255,8 @@ static void gen2QueryStandard(u8 q)
     buf_[1] = ((gen2Config.config.session<<6)&0xC0)/*SESSION*/ | ((0x00<<5)&0x20)/*TARGET*/ | ((q<<1)&0x1E)/*Q*/;
 
     as399xCommandContinuousAddress(&command_[0], 1, AS399X_REG_FIFO, buf_, 2);
+    gen2RoundCount++;
+    TRACE_EVENT(TRACE_QUERY, q);
 }
 
 /*------------------------------------------------------------------------- */
@@ -252,6 +276,7 @@ static u8 gen2ReqRNHandleChar(u8 *handle, u8 *dest_handle)
 {
     u8 ret = GEN2_ERR_REQRN;
 
+    TRACE_EVENT(TRACE_REQRN, 0);
     command_[0] = AS399X_CMD_RESETFIFO;
     command_[1] = AS399X_CMD_TRANSMCRC;
 
@@ -522,6 +547,58 @@ u8 gen2WriteWordToTag(Tag *tag, u8 memBank, u8 wordPtr,
     return (reply);
 }
 
+/*------------------------------------------------------------------------- */
+u8 gen2BlockWriteToTag(Tag *tag, u8 memBank, u8 wordPtr, u8 wordCount,
+                                  u8 *databuf)
+{
+    u8 reply;
+    u8 i;
+    u8 bytes = 5 + 2 * wordCount;        /* full bytes to transmit */
+    u16 bit_count = (2 + 2) * 8 + 1; /* + 2 bytes rn16 + 2bytes crc + 1 header bit */
+
+    if (wordCount == 0 || wordCount > GEN2_BLOCKWRITE_MAXWORDS) return GEN2_ERR_BLOCKWRITE;
+#if EPCDEBUG
+    CON_print("bwDtT %hhx %hhx\n",wordPtr,wordCount);
+#endif
+
+    command_[0] = AS399X_CMD_RESETFIFO;
+    command_[1] = AS399X_CMD_TRANSMCRCEHEAD;
+
+    buf_[0] = bytes >> 4;
+    buf_[1] = (bytes << 4) | 0x05;       /*broken byte 2 extra bits have to be transmitted */
+    buf_[2] = EPC_BLOCKWRITE;            /*Command EPC_BLOCKWRITE, the data is not cover coded */
+
+    buf_[3] = (memBank << 6) & 0xC0;
+    buf_[3] = buf_[3] | ((wordPtr >> 2) & 0x3F);
+    buf_[4] = (wordPtr << 6) & 0xC0;
+    buf_[4] = buf_[4] | ((wordCount >> 2) & 0x3F);
+    buf_[5] = (wordCount << 6) & 0xC0;
+    for (i = 0; i < 2 * wordCount; i++)
+    {
+        buf_[5 + i] = buf_[5 + i] | ((databuf[i] >> 2) & 0x3F);
+        buf_[6 + i] = (databuf[i] << 6) & 0xC0;
+    }
+    i += 5;
+    buf_[i] = buf_[i] | ((tag->handle[0] >> 2) & 0x3F);
+    buf_[i + 1] = (tag->handle[0] << 6) & 0xC0;
+    buf_[i + 1] = buf_[i + 1] | ((tag->handle[1] >> 2) & 0x3F);
+    buf_[i + 2] = (tag->handle[1] << 6) & 0xC0;
+
+    as399xSingleWrite(AS399X_REG_RXLENGTHLOW, bit_count & 0xff);
+    as399xSingleWrite(AS399X_REG_RXLENGTHUP, (bit_count>>8) & 0x03);
+
+    as399xSingleWrite(AS399X_REG_IRQMASKREG, (AS399X_IRQ_MASK_ALL & ~AS399X_IRQ_NORESP));  /*Disables the No Response Interrupt and Header Interrrupt */
+
+    as399xSingleCommand(AS399X_CMD_RESETFIFO);                                /*Resets the FIFO */
+
+    as399xClrResponse();
+
+    as399xCommandContinuousAddress(&command_[1], 1, AS399X_REG_TXLENGTHUP, buf_, i + 3);
+    reply = gen2GetWriteToTagReply(tag->handle);
+    as399xSingleWrite(AS399X_REG_IRQMASKREG, AS399X_IRQ_MASK_ALL);  /*Enable No Response Interrupt */
+    return (reply);
+}
+
 /*------------------------------------------------------------------------- */
 u8 gen2NXPChangeConfig(Tag *tag, u8 *databuf)
 {
@@ -568,35 +645,47 @@ u8 gen2NXPChangeConfig(Tag *tag, u8 *databuf)
 }
 
 /*------------------------------------------------------------------------- */
-u8 gen2ReadFromTag(Tag *tag, u8 memBank, u8 wordPtr,
+/* Adds value to buf_ at byte i shifted by the 2 bits of the memBank field,
+   returns the index of the next byte */
+static u8 gen2PutShifted(u8 i, u8 value)
+{
+    buf_[i] = buf_[i] | ((value >> 2) & 0x3F);
+    buf_[i + 1] = (value << 6) & 0xC0;
+    return i + 1;
+}
+
+/*------------------------------------------------------------------------- */
+u8 gen2ReadFromTag(Tag *tag, u8 memBank, u16 wordPtr,
                           u8 wordCount, u8 *destbuf)
 {
 
+    u8 i = 3;
     u16 bit_count = (wordCount * 2 + 4) * 8 + 1; /* + 2 bytes rn16 + 2bytes crc + 1 header bit */
     u16 bit_count_tag_error_reply = (1 + 2 + 2) * 8 + 1; /* Error Code + 2 bytes rn16 + 2bytes crc + 1 header bit */
 
     u8 length = 0;
     u8 count = 0;
     u8 dataLength;
+
+    TRACE_EVENT(TRACE_READ, wordCount);
     command_[0] = AS399X_CMD_RESETFIFO;
     command_[1] = AS399X_CMD_TRANSMCRCEHEAD;
 
-    buf_[0] = 0x00;
-    buf_[1] = 0x55;                     /*broken byte 2 extra bits has to be transmitted */
     buf_[2] = EPC_READ;                 /*Command EPC_READ */
     buf_[3] = (memBank << 6) & 0xC0;
-    buf_[3] = buf_[3] | ((wordPtr >> 2) & 0x3F);
-    buf_[4] = (wordPtr << 6) & 0xC0;
-    buf_[4] = buf_[4] | ((wordCount >> 2) & 0x3F);
-    buf_[5] = (wordCount << 6) & 0xC0;
-    buf_[5] = buf_[5] | ((tag->handle[0] >> 2) & 0x3F);
-    buf_[6] = ((tag->handle[0] << 6) & 0xC0);
-    buf_[6] = buf_[6] | ((tag->handle[1] >> 2) & 0x3F);
-    buf_[7] = ((tag->handle[1] << 6) & 0xC0);
+    /* wordPtr is an EBV, 7 bits per byte */
+    if (wordPtr >= 0x4000) i = gen2PutShifted(i, 0x80 | (wordPtr >> 14));
+    if (wordPtr >= 0x80) i = gen2PutShifted(i, 0x80 | ((wordPtr >> 7) & 0x7F));
+    i = gen2PutShifted(i, wordPtr & 0x7F);
+    i = gen2PutShifted(i, wordCount);
+    i = gen2PutShifted(i, tag->handle[0]);
+    i = gen2PutShifted(i, tag->handle[1]);
+    buf_[0] = 0x00;
+    buf_[1] = ((i - 2) << 4) | 0x05;    /*broken byte 2 extra bits has to be transmitted */
 
 #if EPCDEBUG
     CON_print("gen2ReadFromTag() buf_[]\n");
-    CON_hexdump(buf_, 8);
+    CON_hexdump(buf_, i + 1);
 #endif
 
 
@@ -606,7 +695,7 @@ u8 gen2ReadFromTag(Tag *tag, u8 memBank, u8 wordPtr,
     as399xSingleCommand(AS399X_CMD_RESETFIFO);
     as399xSingleWrite(AS399X_REG_RXLENGTHLOW, bit_count & 0xff);
     as399xSingleWrite(AS399X_REG_RXLENGTHUP, (bit_count>>8) & 0x03);
-    as399xCommandContinuousAddress(&command_[1], 1, AS399X_REG_TXLENGTHUP, buf_, 8);
+    as399xCommandContinuousAddress(&command_[1], 1, AS399X_REG_TXLENGTHUP, buf_, i + 1);
     as399xWaitForResponse(RESP_TXIRQ);
     as399xClrResponse();
     as399xSingleCommand(AS399X_CMD_RESETFIFO);
@@ -1061,6 +1150,8 @@ static s8 gen2GetTagInSlot( Tag *tag_ )
     {
         if (as399xGetResponse() & RESP_ERROR)
         {
+            if (as399xGetResponse() & RESP_CRCERROR) gen2Stats.crcErrors++;
+            if (as399xGetResponse() & RESP_PREAMBLEERROR) gen2Stats.preambleErrors++;
             retval = -1;
         }
         else
@@ -1096,6 +1187,7 @@ static s8 gen2StoreTagIDFast (Tag *tag, u8 postReplyCommand)
     u16 read_bytes_pc;
     u8 storeFlag, buf_[3];
     u8 *bufPtr;
+    u16 resp;
     s8 ret_value = 0;
     read_bytes_pc = 0;
     fifo_bytes_read = 0;
@@ -1104,9 +1196,14 @@ static s8 gen2StoreTagIDFast (Tag *tag, u8 postReplyCommand)
     as399xWaitForResponse(RESP_RXDONE_OR_ERROR);
     if (as399xGetResponse() & (RESP_NORESINTERRUPT|RESP_ERROR))         /*getting response */
     {
+        if (as399xGetResponse() & RESP_NORESINTERRUPT)
+            gen2Stats.empty++;
+        else
+            gen2Stats.collisions++;
         ret_value = -1;
         goto error;
     }
+    TRACE_EVENT(TRACE_RN16, 0);
     as399xClrResponseMask(RESP_TXIRQ);
     buf_[0] = AS399X_CMD_RESETFIFO;
     buf_[1] = AS399X_CMD_ACKN;
@@ -1114,6 +1211,7 @@ static s8 gen2StoreTagIDFast (Tag *tag, u8 postReplyCommand)
     as399xSingleWrite(AS399X_REG_RXLENGTHUP, 0x40); /* activate header bit == got something interrupt */
     as399xSingleWrite(AS399X_REG_IRQMASKREG, AS399X_IRQ_MASK_ALL);
     as399xWaitForResponse(RESP_TXIRQ);
+    TRACE_EVENT(TRACE_ACK, 0);
 
     as399xSingleCommand(AS399X_CMD_RESETFIFO);
 
@@ -1207,8 +1305,11 @@ static s8 gen2StoreTagIDFast (Tag *tag, u8 postReplyCommand)
         }
 
         /* Send out next command now, to prevent violation of T2 (if QueryRep is sent this will change current session flag on tag). */
+        resp = as399xGetResponse();
         as399xClrResponse();
         as399xSingleCommand(postReplyCommand);
+        TRACE_EVENT(TRACE_EPC, storeFlag);
+        if (resp & RESP_CRCERROR) gen2Stats.crcErrors++;
 
         /* Read the rest of the EPC */
         fifo_count = as399xSingleRead(AS399X_REG_FIFOSTATUS) & 0x1F;
@@ -1239,6 +1340,8 @@ static s8 gen2StoreTagIDFast (Tag *tag, u8 postReplyCommand)
         goto end;
     }
 error:
+    if (as399xGetResponse() & RESP_CRCERROR) gen2Stats.crcErrors++;
+    if (as399xGetResponse() & RESP_PREAMBLEERROR) gen2Stats.preambleErrors++;
     as399xClrResponse();
     /* The post reply (QUERYREP) command needs a RESETFIFO */
     buf_[0] = AS399X_CMD_RESETFIFO;
@@ -1250,20 +1353,29 @@ end:
     return ret_value;
 }
 
-unsigned gen2SearchForTags(Tag *tags_
-                          , u8 maxtags
-                          , u8* mask
-                          , u8 length
-                          , u8 q
-                          , bool (*cbContinueScanning)(void)
-                          , bool useMaskToSelect
-                          )
+struct gen2InventoryStats *gen2GetInventoryStats(void)
 {
-    unsigned num_of_tags_ = 0;
-    u16 collisions = 0;
-    u16 slot_count;
-    u8 count1 = 0;
-    u8 addRounds = 3; /* the maximal number of rounds performed */
+    return &gen2Stats;
+}
+
+u16 gen2GetRoundCount(void)
+{
+    return gen2RoundCount;
+}
+
+s8 gen2CheckHandle(Tag *tag)
+{
+    u8 rn16[2];
+
+    return gen2ReqRNHandleChar(tag->handle, rn16);
+}
+
+/** Common start of the inventory loops in gen2search.h, clears the statistics
+  * and the tag list */
+static void gen2InventoryBegin(Tag *tags_, u8 maxtags, u8* mask, u8 length, u8 q)
+{
+    u8 count1;
+
 #if EPCDEBUG
     CON_print("Searching for Tags, maxtags=%hhd, length=%hhd q=%hhd\n", maxtags, length, q);
     {
@@ -1278,6 +1390,7 @@ unsigned gen2SearchForTags(Tag *tags_
     CON_print("-------------------------------\n");
 #endif
 
+    memset(&gen2Stats, 0, sizeof(gen2Stats));
     as399xClrResponse();
     as399xSingleCommand(AS399X_CMD_RESETFIFO);
     for (count1=0; count1 < maxtags; count1++)   /*Reseting the TAGLIST */
@@ -1285,102 +1398,13 @@ unsigned gen2SearchForTags(Tag *tags_
         *((u16*)tags_[count1].rn16) = 0;
         tags_[count1].epclen=0;
     }
-#if EPCDEBUG
-    CON_print("Sending Select\n");
-#endif
     as399xClrResponse();
+}
 
-    if (useMaskToSelect)
-        gen2Select(mask,length); /* select command with mask and length of mask */
-    else
-        gen2Select(0,0); /* Select all */
-    udelay(300); /* According Standard we have to wait 300 us */
-
-    as399xClrResponse();
-    gen2QueryStandard(q);            /*StandardQuery on the Beginning */
-#if EPCDEBUG
-    CON_print(" ");
-#endif
-    do
-    {
-        bool goOn;
-        collisions = 0;
-        slot_count = 1UL<<q;   /*get the maximum slot_count */
-        do
-        {
-            if (num_of_tags_ >= maxtags)
-            {/*    ERROR it is not possible to store more than maxtags Tags */
-                break;
-            }
-            switch (gen2GetTagInSlot(tags_+num_of_tags_))
-            {
-                case -1:
-#if EPCDEBUG
-                    CON_print("collision\n");
-#endif
-                    collisions++;
-                    break;
-                case 1:
-                    if ( memcmp(tags_[num_of_tags_].epc,mask,length ))
-                    { /* normally the should always be equal, just to be sure... */
-#if EPCDEBUG
-                        CON_print("found EPC did not match mask!");
-#endif
-                    }
-                    else
-                    {
-                        num_of_tags_++;
-                    }
-                    break;
-                case 0:
-#if EPCDEBUG
-                    CON_print("NO EPC response -> empty Slot\n");
-#endif
-                default:
-                    break;
-            }
-            slot_count--;
-            as399xClrResponse();
-            goOn = cbContinueScanning();
-            if (num_of_tags_ < maxtags && slot_count && goOn ) as399xSingleCommand(AS399X_CMD_QUERYREP);
-        } while (slot_count && goOn );
-        addRounds--;
-#if EPCDEBUG
-        CON_print("q=%hhx, collisions=%x, num_of_tags=%x",q,collisions,num_of_tags_);
-#endif
-        if( collisions )
-            if( collisions >= (1UL<<q) /4)
-            {
-                q++;
-#if EPCDEBUG
-                CON_print("->++\n");
-#endif
-                as399xSingleCommand(AS399X_CMD_QUERYADJUSTUP);
-            }
-            else if( collisions < (1UL<<q) /8)
-            {
-                q--;
-#if EPCDEBUG
-                CON_print("->--\n");
-#endif
-                as399xSingleCommand(AS399X_CMD_QUERYADJUSTDOWN);
-            }
-            else
-            {
-#if EPCDEBUG
-                CON_print("->==\n");
-#endif
-                as399xSingleCommand(AS399X_CMD_QUERYADJUSTNIC);
-            }
-        else
-        {
-#if EPCDEBUG
-            CON_print("->!!\n");
-#endif
-            addRounds = 0;
-        }
-    }while(num_of_tags_ < maxtags && addRounds && cbContinueScanning() );
-
+/** Common end of the inventory loops in gen2search.h, resets the reader after
+  * GEN2_RESET_TIMEOUT rounds without any tag */
+static unsigned gen2InventoryEnd(unsigned num_of_tags_)
+{
 #if EPCDEBUG
     CON_print("-------------------------------\n");
     bin2Chars(num_of_tags_, buf_);
@@ -1397,7 +1421,7 @@ unsigned gen2SearchForTags(Tag *tags_
             as399xReset();
             gen2Configure(&gen2Config.config);
             gen2ResetTimeout = GEN2_RESET_TIMEOUT;
-    }
+        }
     }
     else
     {
@@ -1406,98 +1430,70 @@ unsigned gen2SearchForTags(Tag *tags_
     return num_of_tags_;
 }
 
-unsigned gen2SearchForTagsFast(Tag *tags_
-                          , u8 maxtags
-                          , u8* mask
-                          , u8 length
-                          , u8 q
-                          , bool (*cbContinueScanning)(void)
-                          , u8 startCycle
-                          )
+/* Inventory loops, see gen2search.h. The generic variants ask cbContinueScanning
+ * after each slot, the others expand their check inline. */
+#define GEN2_SEARCH             gen2SearchForTags
+#define GEN2_SEARCH_FAST        gen2SearchForTagsFast
+#define GEN2_CONTINUE_PARAM     , bool (*cbContinueScanning)(void)
+#define GEN2_CONTINUE()         cbContinueScanning()
+#include "gen2search.h"
+
+#define GEN2_SEARCH             gen2SearchForTagsTimeout
+#define GEN2_SEARCH_FAST        gen2SearchForTagsFastTimeout
+#define GEN2_CONTINUE_PARAM     , u16 limit
+#define GEN2_CONTINUE()         GEN2_IN_TIME(limit)
+#include "gen2search.h"
+
+#define GEN2_SEARCH_FAST        gen2SearchForTagsFastTimeoutOrAbort
+#define GEN2_CONTINUE_PARAM     , u16 limit
+#define GEN2_CONTINUE()         (GEN2_IN_TIME(limit) && !GEN2_HOST_ABORT())
+#include "gen2search.h"
+
+void gen2ProbeRound(u8 q, bool (*cbContinueScanning)(void))
 {
-    unsigned num_of_tags_ = 0;
     u16 slot_count;
-    u8 count1 = 0;
-
-#if EPCDEBUG
-    CON_print("Searching for Tags, maxtags=%hhd, length=%hhd q=%hhd\n",maxtags,length,q);
-    {
-        int i;
-        CON_print("mask= ");
-        for ( i = 0; i< length; i++)
-        {
-            CON_print("%hhx ",mask[i]);
-        }
-        CON_print("\n");
-    }
-    CON_print("-------------------------------\n");
-#endif
+    u8 cmd[2];
 
+    memset(&gen2Stats, 0, sizeof(gen2Stats));
     as399xClrResponse();
     as399xSingleCommand(AS399X_CMD_RESETFIFO);
-    for (count1=0; count1 < maxtags; count1++)   /*Reseting the TAGLIST */
-    {
-        *((u16*)tags_[count1].rn16) = 0;
-        tags_[count1].epclen=0;
-    }
-    as399xClrResponse();
-
-    if (startCycle)
-        gen2Select(mask,length); /* select command with mask and length of mask */
-
-    udelay(300); /* According Standard we have to wait 300 us */
-
-    as399xClrResponse();
-    gen2QueryStandard(q);            /*StandardQuery on the Beginning */
+    gen2QueryStandard(q);
 
+    cmd[0] = AS399X_CMD_RESETFIFO;
+    cmd[1] = AS399X_CMD_QUERYREP;
+    slot_count = 1UL<<q;
+    do
     {
-        bool goOn = 1;
-        u8 cmd = AS399X_CMD_QUERYREP;
-        slot_count = 1UL<<q;   /*get the maximum slot_count */
-        do
+        slot_count--;
+        gen2Stats.slots++;
+        TRACE_EVENT(TRACE_SLOT, slot_count);
+        as399xWaitForResponse(RESP_TXIRQ | RESP_RXIRQ);
+        as399xWaitForResponse(RESP_RXDONE_OR_ERROR);
+        if (as399xGetResponse() & RESP_NORESINTERRUPT)
         {
-            if (num_of_tags_ >= maxtags)
-            {/*    ERROR it is not possible to store more than maxtags Tags */
-                break;
-            }
-            slot_count--;
-            if (gen2StoreTagIDFast(tags_+num_of_tags_, cmd) == 1)
-            {
-                num_of_tags_++;
-            }
-            goOn = cbContinueScanning();
-        } while (slot_count && goOn );
-        /* Wait until last cmd has been sent */
-        as399xWaitForResponse(RESP_TXIRQ);
-        as399xSingleCommand(AS399X_CMD_BLOCKRX);
-        as399xSingleCommand(AS399X_CMD_RESETFIFO);
-        as399xClrResponse();
-    }
-
-#if EPCDEBUG
-    CON_print("-------------------------------\n");
-    bin2Chars(num_of_tags_, buf_);
-    CON_print(buf_);
-    CON_print("  Tags found");
-    CON_print("\n");
-#endif
-    if (num_of_tags_ == 0)
-    {
-        gen2ResetTimeout--;
-        if (gen2ResetTimeout == 0)
+            gen2Stats.empty++;
+        }
+        else if (as399xGetResponse() & RESP_ERROR)
         {
-            as399xAntennaPower(0);      /* we do not want that rf power is turned on after reset */
-            as399xReset();
-            gen2Configure(&gen2Config.config);
-            gen2ResetTimeout = GEN2_RESET_TIMEOUT;
+            gen2Stats.collisions++;
+            if (as399xGetResponse() & RESP_PREAMBLEERROR) gen2Stats.preambleErrors++;
         }
-    }
-    else
-    {
-        gen2ResetTimeout = GEN2_RESET_TIMEOUT;
-    }
-    return num_of_tags_;
+        else
+        {
+            TRACE_EVENT(TRACE_RN16, 0);
+            gen2Stats.singulated++;
+        }
+        as399xClrResponse();
+        /* Without ACK the replying tag returns to arbitrate with the QueryRep */
+        as399xContinuousCommand(cmd, 2);
+    } while (slot_count && cbContinueScanning());
+    gen2Stats.q = q;
+    as399xWaitForResponse(RESP_TXIRQ);
+    as399xSingleCommand(AS399X_CMD_BLOCKRX);
+    as399xSingleCommand(AS399X_CMD_RESETFIFO);
+    as399xClrResponse();
 }
+
 /*------------------------------------------------------------------------- */
 u8 gen2SetProtectBit(Tag *tag)
 {
@@ -1617,7 +1613,7 @@ u8 gen2Calibrate(Tag *tag)
     return (reply);
 }
 
-u8 gen2ChallengeCommand(u8 commandFlags, cryptoSuiteId, u16 msgBitLength, u8 * message, u8 * output, u8 *outputLength)
+u8 gen2ChallengeCommand(u8 commandFlags, u16 cryptoSuiteId, u16 msgBitLength, u8 * message, u8 * output, u8 *outputLength)
 {
 	u8 ret = GEN2_OK;
 
@@ -1794,170 +1790,98 @@ static u8 gen2GetNxpCCReply(u8 *handle, u8 *config)
     return ret;
 }
 
+#if RUN_ON_AS3992
+#define RXSPECIAL(as3992, as3990) (as3992)
+#else
+#define RXSPECIAL(as3992, as3990) (as3990)
+#endif
+
+/** Register image of one link frequency, see gen2Configure() */
+struct gen2Profile
+{
+    u8 linkFreq;    /* GEN2_LF_40, ... */
+    u8 reg[9];      /* AS399X_REG_PROTOCOLCTRL .. AS399X_REG_RXSPECIAL, 0x06 and
+                       the upper nibble of 0x05 are kept from the chip */
+    u8 DR;          /* divide ratio */
+    u8 altTari;     /* tari setting using altTrcal and DR = 0, 0xff for none */
+    u8 altTrcal[2]; /* AS399X_REG_TRCALREGGEN2, AS399X_REG_TRCALGEN2MISC */
+};
+
+/** Precompiled register images. Miller, tari, session and trext bits are
+  inserted by gen2Configure(), everything else is written as is. */
+static const struct gen2Profile CODE gen2Profiles[] =
+{   /* linkFreq     01    02    03    04    05    06    07    08    09                      DR  altTari  altTrcal */
+    { GEN2_LF_640, {0x00, 0xC0, 0xF2, 0x4D, 0x01, 0x00, 0x04, 0x02, RXSPECIAL(0x07, 0x03)}, 1, 0xff, {0x00, 0x00} },
+    { GEN2_LF_320, {0x00, 0xC0, 0xC2, 0x9A, 0x02, 0x00, 0x06, 0x04, RXSPECIAL(0x27, 0x02)}, 1, 0,    {0xFA, 0x00} }, /* TRcal 66.6us, 25us */
+    { GEN2_LF_256, {0x00, 0xC0, 0x92, 0x41, 0x03, 0x00, 0x05, 0x04, RXSPECIAL(0x37, 0x02)}, 1, 0,    {0x38, 0x01} }, /* TRcal 83.3us, 31.25us */
+    { GEN2_LF_213, {0x00, 0xC0, 0x82, 0xE8, 0x03, 0x00, 0x06, 0x04, RXSPECIAL(0x3B, 0x01)}, 1, 0,    {0x77, 0x01} }, /* TRcal 100us, 37.51us; 0x3B not in data sheet, just an estimation but works! */
+    { GEN2_LF_160, {0x00, 0xC0, 0x62, 0x35, 0x05, 0x00, 0x07, 0x08, RXSPECIAL(0x3F, 0x01)}, 1, 1,    {0xF4, 0x01} }, /* TRcal 133.3us, 50us */
+#if !RUN_ON_AS3992
+    { GEN2_LF_80,  {0x00, 0xC0, 0x32, 0xE8, 0x03, 0x00, 0x0C, 0x07, 0x00                 }, 0, 0xff, {0x00, 0x00} },
+#endif
+    { GEN2_LF_40,  {0x00, 0xC2, 0x02, 0xD0, 0x07, 0x00, 0x1B, 0x0F, RXSPECIAL(0xFF, 0x00)}, 0, 0xff, {0x00, 0x00} }, /* increase TxOne length, only TRcal = 200us allowed */
+};
+
+bool gen2LinkFreqSupported(u8 linkFreq)
+{
+    u8 i;
+
+    for (i = 0; i < sizeof(gen2Profiles) / sizeof(gen2Profiles[0]); i++)
+    {
+        if (gen2Profiles[i].linkFreq == linkFreq) return 1;
+    }
+    return 0;
+}
+
 void gen2Configure(const struct gen2Config *config)
 {
-    /* depending on link frequency setting adjust */
-    /* registers 01, 03, 04, 05, 07, 08, and 09 */
+    const struct gen2Profile CODE *profile = 0;
     u8 reg[9];
     u8 session = config->session;
+    u8 i;
+
     gen2Config.DR = 1;
     gen2Config.config = *config;
     if (session > GEN2_IINV_S3) session = GEN2_IINV_S0; /* limit SL and invalid settings */
     if (gen2Config.config.miller == GEN2_COD_FM0) gen2Config.config.trext = 1;
 
-    //CON_print("Tari: %hhx, LF: %hhx, Cod: %hhx\n", gen2Config.config.tari, gen2Config.config.linkFreq, gen2Config.config.miller);
-    switch (config->linkFreq) {
-    case GEN2_LF_640: /* 640kHz */
-        reg[0] = 0x00; /* AS399X_REG_PROTOCOLCTRL     */
-        reg[1] = 0xC0; /* AS399X_REG_TXOPTGEN2        */
-        reg[2] = 0xF2; /* AS399X_REG_RXOPTGEN2        */
-        reg[3] = 0x4D; /* AS399X_REG_TRCALREGGEN2     */
-        reg[4] = 0x1;  /* AS399X_REG_TRCALGEN2MISC    */
-        reg[5] = 0x04; /* AS399X_REG_RXNORESPWAIT     */
-        reg[6] = 0x02; /* AS399X_REG_RXWAITTIME       */
-#if RUN_ON_AS3992
-        reg[7] = 0x07; /* AS399X_REG_RXSPECIAL        */
-#else
-        reg[7] = 0x03; /* AS399X_REG_RXSPECIAL        */
-#endif
-        break;
-    case GEN2_LF_320: /* 320kHz */
-        reg[0] = 0x00;
-        reg[1] = 0xC0;
-        reg[2] = 0xC2;
-        if (gen2Config.config.tari == 0)    /* if Tari = 6.25us */
-        {   /* TRcal = 25us */
-            gen2Config.DR = 0;
-            reg[3] = 0xFA;
-            reg[4] = 0x00;
-        } else
-        {   /* TRcal = 66.6us */
-            reg[3] = 0x9A;
-            reg[4] = 0x02;
-        }
-        reg[5] = 0x06;
-        reg[6] = 0x04;
-#if RUN_ON_AS3992
-        reg[7] = 0x27;
-#else
-        reg[7] = 0x02;
-#endif
-        break;
-    case GEN2_LF_256: /* 256kHz */
-        reg[0] = 0x00;
-        reg[1] = 0xC0;
-        reg[2] = 0x92;
-        if (gen2Config.config.tari == 0)    /* if Tari = 6.25us */
-        {   /* TRcal = 31.25us */
-            gen2Config.DR = 0;
-            reg[3] = 0x38;
-            reg[4] = 0x01;
-        } else
-        {   /* TRcal = 83.3us */
-            reg[3] = 0x41;
-            reg[4] = 0x03;
-        }
-        reg[5] = 0x05;
-        reg[6] = 0x04;
-#if RUN_ON_AS3992
-        reg[7] = 0x37;
-#else
-        reg[7] = 0x02;
-#endif
-        break;
-    case GEN2_LF_213: /* 213.3kHz */
-        reg[0] = 0x00;
-        reg[1] = 0xC0;
-        reg[2] = 0x82;
-        if (gen2Config.config.tari == 0)    /* if Tari = 6.25us */
-        {   /* TRcal = 37.51us */
-            gen2Config.DR = 0;
-            reg[3] = 0x77;
-            reg[4] = 0x1;
-        } else
-        {   /* TRcal = 100us */
-            reg[3] = 0xE8;
-            reg[4] = 0x3;
-        }
-        reg[5] = 0x06;
-        reg[6] = 0x04;
-#if RUN_ON_AS3992
-        reg[7] = 0x3B; /* Not in data sheet, just an estimation but works! */
-#else
-        reg[7] = 0x01;
-#endif
-        break;
-    case GEN2_LF_160: /* 160kHz */
-        reg[0] = 0x00;
-        reg[1] = 0xC0;
-        reg[2] = 0x62;
-        if (gen2Config.config.tari == 1)    /* if Tari = 12.5us */
-        {   /* TRcal = 50us */
-            gen2Config.DR = 0;
-            reg[3] = 0xF4;
-            reg[4] = 0x1;
-        } else
-        {   /* TRcal = 133.3us */
-            reg[3] = 0x35;
-            reg[4] = 0x5;
-        }
-        reg[5] = 0x07;
-        reg[6] = 0x08;
-#if RUN_ON_AS3992
-        if(gen2Config.config.miller == GEN2_COD_FM0)
-        {
-            reg[7] = 0xbf;
-        }
-        else
+    for (i = 0; i < sizeof(gen2Profiles) / sizeof(gen2Profiles[0]); i++)
+    {
+        if (gen2Profiles[i].linkFreq == config->linkFreq)
         {
-            reg[7] = 0x3f;
+            profile = &gen2Profiles[i];
+            break;
         }
-#else
-        reg[7] = 0x01;
-#endif
-        break;
-#if !RUN_ON_AS3992
-    case GEN2_LF_80: /* 80kHz */
-        reg[0] = 0x00;
-        reg[1] = 0xC0;
-        reg[2] = 0x32;
-        reg[3] = 0xE8;
-        reg[4] = 0x3;
-        reg[5] = 0x0C;
-        reg[6] = 0x07;
-        reg[7] = 0x00;
+    }
+    if (!profile) return; /* use preset settings */
+
+    //CON_print("Tari: %hhx, LF: %hhx, Cod: %hhx\n", gen2Config.config.tari, gen2Config.config.linkFreq, gen2Config.config.miller);
+    /* registers 05 and 06 are partly global, read them first */
+    as399xContinuousRead(AS399X_REG_TRCALGEN2MISC, 2, reg+4);
+    i = reg[4] & 0xf0;
+    memcpy(reg, profile->reg, 4);
+    memcpy(reg+6, profile->reg+6, 3);
+    reg[4] = i | profile->reg[4];
+    gen2Config.DR = profile->DR;
+    if (profile->altTari == gen2Config.config.tari)
+    {
         gen2Config.DR = 0;
-        break;
-#endif
-    case GEN2_LF_40: /* 40kHz */
-        reg[0] = 0x00;
-        reg[1] = 0xC2;      /* increase TxOne length for 40kHz */
-        reg[2] = 0x02;
-        reg[3] = 0xD0;      /* only TRcal = 200us allowed */
-        reg[4] = 0x7;
-        reg[5] = 0x1B;
-        reg[6] = 0x0F;
+        reg[3] = profile->altTrcal[0];
+        reg[4] = i | profile->altTrcal[1];
+    }
 #if RUN_ON_AS3992
-        reg[7] = 0xFF;
-#else
-        reg[7] = 0x00;
-#endif
-        gen2Config.DR = 0;
-        break;
-    default:
-        return; /* use preset settings */
+    if (config->linkFreq == GEN2_LF_160 && gen2Config.config.miller == GEN2_COD_FM0)
+    {
+        reg[8] = 0xbf;
     }
+#endif
     reg[0] = (reg[0] & ~0xc) | (gen2Config.config.miller<<2);
     reg[0] = (reg[0] & ~0x3) | (gen2Config.config.tari);
     reg[1] = (reg[1] & ~0x3) | session;
     reg[2] = (reg[2] & ~0x2) | (!!gen2Config.config.trext<<1);
 
-    /* Modify only the gen2 relevant settings */
-    as399xContinuousWrite(AS399X_REG_PROTOCOLCTRL, reg+0, 4);
-    /* Leave upper nibble of global regs */
-    as399xSingleWrite(AS399X_REG_TRCALGEN2MISC, 
-                      (as399xSingleRead(AS399X_REG_TRCALGEN2MISC) & 0xf0) | reg[4] );
-    as399xContinuousWrite(AS399X_REG_RXNORESPWAIT, reg+5 , 3);
+    /* Modify only the gen2 relevant settings, in one burst */
+    as399xContinuousWrite(AS399X_REG_PROTOCOLCTRL, reg, 9);
 }
 
 void gen2Open(const struct gen2Config * config)
@@ -178,6 +178,10 @@
 #define GEN2_ERR_CHANNEL_TIMEOUT 10 /**< Error RF channel timed out*/
 #define GEN2_CRC                 11 /**< Error CRC */
 
+/** Most words written by one gen2BlockWriteToTag(), the command has to fit
+  * into the AS399x FIFO */
+#define GEN2_BLOCKWRITE_MAXWORDS 8
+
 
 struct gen2Config{
     u8 linkFreq; /* GEN2_LF_40, ... */
@@ -187,6 +191,20 @@ struct gen2Config{
     u8 tari;    /* Tari setting */
 };
 
+/** Statistics of the last inventory round, see gen2GetInventoryStats() */
+struct gen2InventoryStats{
+    u16 slots;          /* number of slots, including additional rounds of gen2SearchForTags() */
+    u16 empty;          /* slots without reply */
+    u16 singulated;     /* slots with a successfully read epc */
+    u16 collisions;     /* slots with an erroneous RN16 */
+    u16 crcErrors;      /* replies with CRC error */
+    u16 preambleErrors; /* replies with preamble error */
+    u16 fails[4];       /* gen2SearchForTagsFast() only: slots failed in class -1 (no or erroneous RN16),
+                           -2 (no or erroneous reply to ACK), -3 (error during epc reception),
+                           -4 (epc length does not match pc) */
+    u8 q;               /* final q */
+};
+
 struct gen2GenericCmdData{
 	u16 txBitCount;			/* INPUT: number of bits to be TX'ed, excluding RN16 and CRC16 */
 	u16 rxBitCount;			/* INPUT: number of bits to be RX'ed, excluding RN16 and CRC16 */
@@ -210,7 +228,7 @@ struct gen2GenericCmdData{
   * @param *outputLength pointer to variable which stores size of valid data in response buffer in bytes.
   */
 u8 gen2ChallengeCommand(u8 commandFlags
-					    , cryptoSuiteId
+					    , u16 cryptoSuiteId
 					    , u16 msgBitLength
 					    , u8 * message
 					    , u8 * output
@@ -264,6 +282,77 @@ unsigned gen2SearchForTagsFast(Tag *tags_
                           , bool (*cbContinueScanning)(void)
                           , u8 startCycle
                           );
+
+/** Variant of gen2SearchForTags() which ends the rounds when limit slow ticks
+  * have passed since timerStartMeasure() (see timerMeasure_slowTicks()). The
+  * check is expanded inline into the slot loop instead of calling a callback,
+  * see gen2search.h. With limit 0 all slots are scanned.
+  */
+unsigned gen2SearchForTagsTimeout(Tag *tags
+                          , u8 maxtags
+                          , u8* mask
+                          , u8 length
+                          , u8 q
+                          , u16 limit
+                          , bool useMaskToSelect
+                          );
+
+/** Variant of gen2SearchForTagsFast() with the time limit of
+  * gen2SearchForTagsTimeout(). With limit 0 all slots are scanned.
+  */
+unsigned gen2SearchForTagsFastTimeout(Tag *tags_
+                          , u8 maxtags
+                          , u8* mask
+                          , u8 length
+                          , u8 q
+                          , u16 limit
+                          , u8 startCycle
+                          );
+
+/** Variant of gen2SearchForTagsFastTimeout() which in addition ends the round
+  * as soon as the host sends a command. Only for rounds not started by a host
+  * command, e.g. cyclic inventory, as the receive flag is set while one is
+  * processed.
+  */
+unsigned gen2SearchForTagsFastTimeoutOrAbort(Tag *tags_
+                          , u8 maxtags
+                          , u8* mask
+                          , u8 length
+                          , u8 q
+                          , u16 limit
+                          , u8 startCycle
+                          );
+
+/** Runs one inventory round with 2^q slots without acknowledging any tag, so
+  * the inventoried flags of the tags are not changed. Only the RN16 replies are
+  * classified, the result is found in gen2GetInventoryStats(): singulated counts
+  * the slots with one valid RN16.
+  */
+void gen2ProbeRound(u8 q, bool (*cbContinueScanning)(void));
+/*------------------------------------------------------------------------- */
+/** Returns the statistics of the last inventory round done by
+  * gen2SearchForTags(), gen2SearchForTagsFast() or gen2ProbeRound().
+  */
+struct gen2InventoryStats *gen2GetInventoryStats(void);
+
+/*------------------------------------------------------------------------- */
+/** Returns a counter incremented with every Select and Query sent. Both put
+  * a tag in open or secured state back to ready, so its handle is only
+  * valid as long as the counter did not change since it was singulated.
+  * 16 bits wide: a cyclic inventory between two commands easily runs 256
+  * rounds, which would wrap an 8 bit counter back to the same value.
+  */
+u16 gen2GetRoundCount(void);
+
+/*------------------------------------------------------------------------- */
+/** Checks if the tag still is in open or secured state by sending a Req_RN
+  * with its handle, the tag answers with a new RN16 but keeps its handle.
+  *
+  * @param *tag Tag with the handle to check.
+  * @return GEN2_OK if the tag answered, GEN2_ERR_REQRN otherwise.
+  */
+s8 gen2CheckHandle(Tag *tag);
+
 /*------------------------------------------------------------------------- */
 /** EPC ACCESS command send to the Tag.
   * This function is used to bring a tag with set access password from the Open
@@ -333,6 +422,29 @@ u8 gen2KillTag(Tag *tag, u8 *password, u8 rfu);
   */
 u8 gen2WriteWordToTag(Tag *tag, u8 memBank, u8 wordPtr, u8 *databuf);
 
+/*------------------------------------------------------------------------- */
+/** EPC BLOCKWRITE command send to the Tag.
+  * This function writes several words with one command. The data is not
+  * cover coded, so no new handle has to be requested. Tags supporting
+  * BlockWrite may still limit the number of words, they reply with an error
+  * code then.
+  *
+  * @attention This command works on the one tag which is currently in the open 
+  *            state, i.e. on the last tag found by gen2SearchForTags().
+  *
+  * @param *tag Pointer to the Tag structure.
+  * @param memBank Memory Bank to which the data should be written.
+  * @param wordPtr Word Pointer Address to which the data should be written.
+  * @param wordCount Number of words to write, 1 .. GEN2_BLOCKWRITE_MAXWORDS.
+  * @param *databuf Pointer to the first byte of the data array. The data buffer
+                             has to be 2 * wordCount bytes long.
+  * @return The function returns an errorcode.
+                  0x00 means no error occoured.
+                  GEN2_ERR_BLOCKWRITE if wordCount is out of range.
+                  Any other value is the backscattered error code from the tag.
+  */
+u8 gen2BlockWriteToTag(Tag *tag, u8 memBank, u8 wordPtr, u8 wordCount, u8 *databuf);
+
 /*------------------------------------------------------------------------- */
 /** NXP Custom command ChangeConfig sent to the tag.
   * @attention Before issuing tag needs to be in secured state using non-zero 
@@ -358,14 +470,15 @@ u8 gen2NXPChangeConfig(Tag *tag, u8 *databuf);
   * @param *tag Pointer to the Tag structure.
   * @param memBank Memory Bank to which the data should be written.
   * @param wordPtr Word Pointer Address to which the data should be written.
-  * @param wordCount Number of bytes to read from the tag.
+  * @param wordCount Number of words to read from the tag, at most 60 as the
+  *        reply has to fit into the receive length of the AS399x.
   * @param *destbuf Pointer to the first byte of the data array.
   * @return The function returns an errorcode.
                   0x00 means no error occoured.
                   0xFF unknown error occoured.
                   Any other value is the backscattered error code from the tag.
   */
-u8 gen2ReadFromTag(Tag *tag, u8 memBank, u8 wordPtr,
+u8 gen2ReadFromTag(Tag *tag, u8 memBank, u16 wordPtr,
                           u8 wordCount, u8 *destbuf);
 
 /*------------------------------------------------------------------------- */
@@ -448,6 +561,13 @@ void gen2PrintTagInfo(Tag *tag, u8 epclen, u8 tagNr);
  */
 void gen2Configure(const struct gen2Config *config);
 
+/*------------------------------------------------------------------------- */
+/** Checks if gen2Configure() has a register image for a link frequency.
+  * @param linkFreq GEN2_LF_40, ...
+  * @return 1 if supported, 0 if gen2Configure() would keep the preset settings.
+  */
+bool gen2LinkFreqSupported(u8 linkFreq);
+
 /*!
  *****************************************************************************
  *  \brief  Open a session
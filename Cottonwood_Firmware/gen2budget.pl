@@ -0,0 +1,138 @@
+#!/usr/bin/perl
+#
+# Gen2 link timing budget and throughput calculator for the gen2Configure()
+# profiles, based on Gen2Timing.pm.
+#
+# For every selected profile the air time of the commands and replies and
+# the slot durations are printed, followed by the expected tags/s over the
+# tag population: theoretical (no firmware overhead) and predicted (with
+# the overhead per slot). The overhead is either given with -o or derived
+# from a trace dump (-T, see trace.h): the measured duration of the slots
+# which singulated a tag minus their modelled air time. The trace also
+# gives the measured rate, which is compared to the prediction.
+#
+# usage: gen2budget.pl [options]
+#   -l list    link frequencies in kHz, e.g. 320,640 (default all AS3992 ones)
+#   -M list    codings 0 = FM0, 1 = M2, 2 = M4, 3 = M8 (default 2)
+#   -t list    tari settings 0 = 6.25us, 1 = 12.5us, 2 = 25us (default 2)
+#   -x         long preamble (TRext)
+#   -e bytes   EPC length (default 12)
+#   -n list    tag populations (default 1,5,10,20,50,100)
+#   -q q       fixed q instead of the best q per population
+#   -o us      firmware overhead per slot (default 0)
+#   -T file    trace dump to derive overhead and measured rate from
+#
+use strict;
+use warnings;
+use Getopt::Std;
+use FindBin;
+use lib $FindBin::Bin;
+use Gen2Timing;
+
+my %opt;
+getopts('l:M:t:xe:n:q:o:T:', \%opt) or die "see header of $0 for usage\n";
+
+my %lfCode = map { (int($Gen2Timing::LF{$_}) => $_) } keys %Gen2Timing::LF;
+my @lfs    = map { exists $lfCode{$_} ? $lfCode{$_} : die "unknown link frequency $_\n" }
+             split /,/, ($opt{l} // "40,160,213,256,320,640");
+my @codes  = split /,/, ($opt{M} // "2");
+my @taris  = split /,/, ($opt{t} // "2");
+my @pops   = split /,/, ($opt{n} // "1,5,10,20,50,100");
+my $overhead = ($opt{o} // 0) * 1e-6;
+
+#--------------------------------------------------------------------------
+# trace evaluation: durations of slots with a singulated tag
+my (@singleSlots, $measuredRate);
+if ($opt{T})
+{
+    my @entries;
+    open(my $fh, '<', $opt{T}) or die "$opt{T}: $!\n";
+    while (my $line = <$fh>)
+    {
+        $line =~ s/^\s+//;
+        my @b = map { hex } split /[\s,]+/, $line;
+        next if (@b < 4 || $b[0] != 0x68);
+        for (my $i = 0; $i < $b[3]; $i++)
+        {
+            my $o = 4 + 4 * $i;
+            push @entries, [ $b[$o], $b[$o + 1], $b[$o + 2] | ($b[$o + 3] << 8) ] if ($o + 3 <= $#b);
+        }
+    }
+    close($fh);
+
+    my ($time, $last) = (0, undef);
+    my ($slotStart, $single, $first, $lastSlot, $tags) = (undef, 0, undef, undef, 0);
+    foreach my $e (@entries)
+    {
+        my ($id, $arg, $ticks) = @$e;
+        $time += defined $last ? (($ticks - $last) & 0xffff) * 16 / 3 * 1e-6 : 0;
+        $last = $ticks;
+        if ($id == 0x01 || $id == 0x02)
+        {
+            push @singleSlots, $time - $slotStart if (defined $slotStart && $single);
+            $slotStart = ($id == 0x02) ? $time : undef;   # the Query slot also contains the Query
+            $first //= $time;
+            $lastSlot = $time;
+            $single = 0;
+        }
+        elsif ($id == 0x05 && $arg == 1)
+        {
+            $single = 1;
+            $tags++;
+        }
+        elsif ($id != 0x03 && $id != 0x04)
+        {   # anything else ends the inventory
+            undef $slotStart;
+        }
+    }
+    die "no slots with a singulated tag in $opt{T}\n" unless (@singleSlots);
+    $measuredRate = $tags / ($lastSlot - $first) if (defined $lastSlot && $lastSlot > $first);
+}
+
+sub us { return sprintf("%8.1f", $_[0] * 1e6); }
+
+foreach my $lf (@lfs)
+{
+    foreach my $cod (@codes)
+    {
+        foreach my $tari (@taris)
+        {
+            my $p = Gen2Timing->new(lf => $lf, miller => $cod, tari => $tari,
+                                    trext => $opt{x} ? 1 : 0, epc => $opt{e} // 12);
+            my $ovh = $overhead;
+            if (@singleSlots)
+            {
+                my $avg = 0;
+                $avg += $_ / @singleSlots foreach (@singleSlots);
+                $ovh = $avg - $p->slotSingle(0);
+                $ovh = 0 if ($ovh < 0);
+            }
+            my $epcBits = 16 + 8 * $p->{epc} + 16;
+
+            print "== ", $p->name, ", EPC $p->{epc} bytes\n";
+            print "   T1 ", us($p->{t1}), "us  T2 ", us($p->{t2}), "us  T4 ", us($p->{t4}),
+                  "us  TRcal ", us($p->{trcal}), "us\n";
+            print "   Query     ", us($p->command($Gen2Timing::CMD{query}, 1)), "us   RN16   ", us($p->reply(16)), "us\n";
+            print "   QueryRep  ", us($p->command($Gen2Timing::CMD{queryrep})), "us   EPC    ", us($p->reply($epcBits)), "us\n";
+            print "   ACK       ", us($p->command($Gen2Timing::CMD{ack})), "us   ReqRN  ", us($p->reqRN()), "us (incl. reply)\n";
+            print "   slot empty ", us($p->slotEmpty(0)), "us  collision ", us($p->slotCollision(0)),
+                  "us  single ", us($p->slotSingle(0)), "us\n";
+            printf "   overhead  %s us per slot%s\n", us($ovh), @singleSlots ? sprintf(" (from %d slots in trace)", scalar @singleSlots) : "";
+            printf "   %6s %4s %12s %12s %8s\n", "tags", "q", "theory/s", "predict/s", "loss";
+            foreach my $n (@pops)
+            {
+                my ($q, $theory) = defined $opt{q} ? ($opt{q}, $p->throughput($n, $opt{q}, 0)) : $p->bestQ($n, 0);
+                my $pred = $p->throughput($n, $q, $ovh);
+                printf "   %6d %4d %12.1f %12.1f %7.1f%%\n", $n, $q, $theory, $pred, 100 * (1 - $pred / $theory);
+            }
+            if (defined $measuredRate)
+            {   # compare against the largest population given
+                my $n = $pops[-1];
+                my ($q, $theory) = defined $opt{q} ? ($opt{q}, $p->throughput($n, $opt{q}, 0)) : $p->bestQ($n, 0);
+                printf "   measured %.1f tags/s in trace, %.1f%% below theory for %d tags\n",
+                    $measuredRate, 100 * (1 - $measuredRate / $theory), $n;
+            }
+            print "\n";
+        }
+    }
+}
@@ -0,0 +1,223 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Inventory loops of gen2SearchForTags() and gen2SearchForTagsFast().
+  *
+  * After each slot the loops decide whether the round goes on. Calling a
+  * callback for this through a function pointer is expensive on the 8051:
+  * Keil C51 cannot inline and the indirect call goes through ?C?ICALL. So
+  * gen2.c includes this file once per way of deciding and gets one copy of
+  * the loops each. Before the inclusion define:
+  * - GEN2_SEARCH: name of the gen2SearchForTags() variant, leave undefined to skip it
+  * - GEN2_SEARCH_FAST: name of the gen2SearchForTagsFast() variant, leave undefined to skip it
+  * - GEN2_CONTINUE_PARAM: declaration of the parameter the check uses, with leading comma
+  * - GEN2_CONTINUE(): the check, 0 ends the round
+  *
+  * The macros are undefined at the end of this file. There is no include
+  * guard on purpose.
+  */
+
+#ifdef GEN2_SEARCH
+unsigned GEN2_SEARCH(Tag *tags_
+                          , u8 maxtags
+                          , u8* mask
+                          , u8 length
+                          , u8 q
+                          GEN2_CONTINUE_PARAM
+                          , bool useMaskToSelect
+                          )
+{
+    unsigned num_of_tags_ = 0;
+    u16 collisions = 0;
+    u16 slot_count;
+    u8 addRounds = 3; /* the maximal number of rounds performed */
+
+    gen2InventoryBegin(tags_, maxtags, mask, length, q);
+#if EPCDEBUG
+    CON_print("Sending Select\n");
+#endif
+
+    if (useMaskToSelect)
+        gen2Select(mask,length); /* select command with mask and length of mask */
+    else
+        gen2Select(0,0); /* Select all */
+    schedWait_us(300); /* According Standard we have to wait 300 us */
+
+    as399xClrResponse();
+    gen2QueryStandard(q);            /*StandardQuery on the Beginning */
+#if EPCDEBUG
+    CON_print(" ");
+#endif
+    do
+    {
+        bool goOn;
+        collisions = 0;
+        slot_count = 1UL<<q;   /*get the maximum slot_count */
+        do
+        {
+            if (num_of_tags_ >= maxtags)
+            {/*    ERROR it is not possible to store more than maxtags Tags */
+                break;
+            }
+            gen2Stats.slots++;
+            switch (gen2GetTagInSlot(tags_+num_of_tags_))
+            {
+                case -1:
+#if EPCDEBUG
+                    CON_print("collision\n");
+#endif
+                    collisions++;
+                    gen2Stats.collisions++;
+                    break;
+                case 1:
+                    if ( memcmp(tags_[num_of_tags_].epc,mask,length ))
+                    { /* normally the should always be equal, just to be sure... */
+#if EPCDEBUG
+                        CON_print("found EPC did not match mask!");
+#endif
+                    }
+                    else
+                    {
+                        num_of_tags_++;
+                        gen2Stats.singulated++;
+                    }
+                    break;
+                case 0:
+#if EPCDEBUG
+                    CON_print("NO EPC response -> empty Slot\n");
+#endif
+                    gen2Stats.empty++;
+                default:
+                    break;
+            }
+            slot_count--;
+            as399xClrResponse();
+            goOn = GEN2_CONTINUE();
+            if (num_of_tags_ < maxtags && slot_count && goOn ) as399xSingleCommand(AS399X_CMD_QUERYREP);
+        } while (slot_count && goOn );
+        addRounds--;
+#if EPCDEBUG
+        CON_print("q=%hhx, collisions=%x, num_of_tags=%x",q,collisions,num_of_tags_);
+#endif
+        if( collisions )
+            if( collisions >= (1UL<<q) /4)
+            {
+                q++;
+#if EPCDEBUG
+                CON_print("->++\n");
+#endif
+                as399xSingleCommand(AS399X_CMD_QUERYADJUSTUP);
+            }
+            else if( collisions < (1UL<<q) /8)
+            {
+                q--;
+#if EPCDEBUG
+                CON_print("->--\n");
+#endif
+                as399xSingleCommand(AS399X_CMD_QUERYADJUSTDOWN);
+            }
+            else
+            {
+#if EPCDEBUG
+                CON_print("->==\n");
+#endif
+                as399xSingleCommand(AS399X_CMD_QUERYADJUSTNIC);
+            }
+        else
+        {
+#if EPCDEBUG
+            CON_print("->!!\n");
+#endif
+            addRounds = 0;
+        }
+    }while(num_of_tags_ < maxtags && addRounds && GEN2_CONTINUE() );
+    gen2Stats.q = q;
+    return gen2InventoryEnd(num_of_tags_);
+}
+#endif
+
+#ifdef GEN2_SEARCH_FAST
+unsigned GEN2_SEARCH_FAST(Tag *tags_
+                          , u8 maxtags
+                          , u8* mask
+                          , u8 length
+                          , u8 q
+                          GEN2_CONTINUE_PARAM
+                          , u8 startCycle
+                          )
+{
+    unsigned num_of_tags_ = 0;
+    u16 slot_count;
+
+    gen2InventoryBegin(tags_, maxtags, mask, length, q);
+
+    if (startCycle)
+        gen2Select(mask,length); /* select command with mask and length of mask */
+
+    schedWait_us(300); /* According Standard we have to wait 300 us */
+
+    as399xClrResponse();
+    gen2QueryStandard(q);            /*StandardQuery on the Beginning */
+
+    {
+        bool goOn = 1;
+        u8 cmd = AS399X_CMD_QUERYREP;
+        s8 result;
+        slot_count = 1UL<<q;   /*get the maximum slot_count */
+        do
+        {
+            if (num_of_tags_ >= maxtags)
+            {/*    ERROR it is not possible to store more than maxtags Tags */
+                break;
+            }
+            slot_count--;
+            gen2Stats.slots++;
+            TRACE_EVENT(TRACE_SLOT, slot_count);
+            BENCH_BEGIN(BENCH_TAG);
+            result = gen2StoreTagIDFast(tags_+num_of_tags_, cmd);
+            if (result == 1)
+            {
+                BENCH_END(BENCH_TAG);
+                num_of_tags_++;
+                gen2Stats.singulated++;
+            }
+            else if (result < 0)
+            {
+                gen2Stats.fails[-result-1]++;
+            }
+            goOn = GEN2_CONTINUE();
+        } while (slot_count && goOn );
+        gen2Stats.q = q;
+        /* Wait until last cmd has been sent */
+        as399xWaitForResponse(RESP_TXIRQ);
+        as399xSingleCommand(AS399X_CMD_BLOCKRX);
+        as399xSingleCommand(AS399X_CMD_RESETFIFO);
+        as399xClrResponse();
+    }
+    return gen2InventoryEnd(num_of_tags_);
+}
+#endif
+
+#undef GEN2_SEARCH
+#undef GEN2_SEARCH_FAST
+#undef GEN2_CONTINUE_PARAM
+#undef GEN2_CONTINUE
@@ -157,6 +157,38 @@ void copyBuffer(u8 *source, u8 *dest, u8 len)
     }
 }
 
+void u16ToBuffer(u16 value, u8 *dest)
+{
+    dest[0] = value & 0xff;
+    dest[1] = (value >> 8) & 0xff;
+}
+
+void u32ToBuffer(u32 value, u8 *dest)
+{
+    u16ToBuffer(value & 0xffff, dest);
+    u16ToBuffer(value >> 16, dest + 2);
+}
+
+u8 squareRoot(u16 value)
+{
+    u16 root = 0;
+    u16 step = 0x4000;
+    while (step)
+    {
+        if (value >= root + step)
+        {
+            value -= root + step;
+            root = (root >> 1) + step;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        step >>= 2;
+    }
+    return root;
+}
+
 u8 stringLength(char *source)
 {
     u8 count = 0;
@@ -56,6 +56,13 @@ extern void bin2Hex(char value, unsigned char *destbuf);
 
 extern void copyBuffer(unsigned char *source, unsigned char *dest, unsigned char len);
 extern unsigned char stringLength(char *source);
+/** Store value LSB first into dest, as used in USB reports */
+extern void u16ToBuffer(u16 value, u8 *dest);
+/** Store value LSB first into dest, as used in USB reports */
+extern void u32ToBuffer(u32 value, u8 *dest);
+/** Integer square root, rounded down. Replaces sqrt() of math.h, which would
+  link the floating point library */
+extern u8 squareRoot(u16 value);
 extern void bitArrayCopy(const u8 *src_org, s16 src_offset, s16 src_len, u8 *dst_org, s16 dst_offset);
 
 
@@ -0,0 +1,1396 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Register level model of the AS399x and of a population of Gen2 tags.
+  *
+  * Replaces as399x_com.c in the host build, see Makefile. writeReadAS399x()
+  * and writeReadAS399xIsr() operate on the registers, the FIFO and the direct
+  * commands of the model instead of the parallel interface. The transmitter
+  * and the receiver run on the virtual clock of sim.h: a command goes out
+  * on air for the time given by tari and its length, the tags evaluate it
+  * at its end and the reply comes in byte by byte at the link frequency
+  * programmed in AS399X_REG_RXOPTGEN2. The interrupt flags follow what the
+  * firmware expects from the chip:
+  *  - IRQSTATUS is cleared on read, masked flags are recorded but do not
+  *    raise the interrupt line. TX and RX cannot be masked.
+  *  - The FIFO interrupt is raised at 18 bytes received and when a frame to
+  *    be transmitted needs more bytes than written so far.
+  *  - A reply with header bit set raises HEADER after the header bit. With
+  *    bit 6 of AS399X_REG_RXLENGTHUP set (see gen2StoreTagIDFast()) HEADER
+  *    is raised once the first two bytes have been received.
+  *  - Replies keep their CRC in the FIFO only in the latter mode.
+  *  - More than one tag replying is a collision, reported as PREAMBLE error.
+  *  - No reply raises NORESP after RXNORESPWAIT * 25.6us unless it is
+  *    masked, delayed replies (Write, BlockWrite, Kill, Lock) come after 3ms.
+  *
+  * The tags implement the Gen2 state machine with Select, Query, QueryRep,
+  * QueryAdjust, ACK, NAK, Req_RN, Read, Write, BlockWrite (up to
+  * SIM_BLOCKWRITE_MAX words), Kill, Lock and Access. All tags hear every
+  * command, there is no path loss and no T2 timeout. Lock is acknowledged
+  * but not enforced. EPC replies are received with CRC error at a rate
+  * which grows as the RSSI of the tag drops, see simTagsInit().
+  *
+  * Slots, reads and the time until each tag was read first are counted,
+  * simPrintStats() prints them at the end of the run.
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "keil.h"
+#include "sim.h"
+#include "as399x_com.h"
+#include "as399x.h"
+#include "platform.h"
+
+/** Interrupt service routine of as399x.c */
+extern void extInt(void);
+
+/** Maximum number of tags */
+#define SIM_MAXTAGS             10000
+/** Words of the EPC memory bank, StoredCRC, PC and up to 256 bit EPC */
+#define SIM_EPCWORDS            18
+/** Words of the TID memory bank */
+#define SIM_TIDWORDS            6
+/** Words of the user memory bank */
+#define SIM_USERWORDS           32
+/** Largest BlockWrite the tags accept, larger ones get an error reply */
+#define SIM_BLOCKWRITE_MAX      2
+/** Delay of the replies to Write, BlockWrite, Kill and Lock */
+#define SIM_DELAYED_US          3000
+/** S1 returns to A after this time, the persistence of S2, S3 and SL is unlimited */
+#define SIM_S1_PERSISTENCE_US   2000000
+
+/** Cycles one access to the AS399x takes, with per byte cost */
+#define SIM_ACCESS_CYCLES       SIM_NS(400)
+#define SIM_BYTE_CYCLES         SIM_NS(250)
+
+/** Gen2 error codes of the tag error reply */
+#define TAGERR_OTHER            0x00
+#define TAGERR_OVERRUN          0x03
+#define TAGERR_NONSPECIFIC      0x0F
+
+enum tagState { READY, ARBITRATE, REPLY, ACKNOWLEDGED, OPEN, SECURED, KILLED };
+enum chipPhase { PHASE_IDLE, PHASE_TX, PHASE_WAIT, PHASE_RX };
+enum busState { BUS_IDLE, BUS_ADDR, BUS_WRITE, BUS_READ };
+
+struct simTag
+{
+    u8 state;
+    u8 inv[4];              /* inventoried flags, 0 = A */
+    uint64_t s1SetAt;       /* when S1 went to B */
+    u8 sl;
+    u8 session;             /* of the current round */
+    u8 q;
+    u16 slot;
+    u8 m;                   /* 1, 2, 4, 8 as set by Query */
+    u8 trext;
+    u16 rn16;               /* last backscattered RN16, also cover code */
+    u16 handle;
+    u8 killStep, accessStep;
+    u8 rssi;                /* 0x40 .. 0x7f, lower 6 bits are the link quality */
+    uint64_t firstRead;     /* time of the first EPC received without error, 0 if none */
+    u8 reserved[8];
+    u8 epc[2 * SIM_EPCWORDS];
+    u8 tid[2 * SIM_TIDWORDS];
+    u8 user[2 * SIM_USERWORDS];
+};
+
+static struct simTag tags_[SIM_MAXTAGS];
+static unsigned numTags_;
+static unsigned crcErrors_;
+static uint32_t rand_ = 1;
+
+/** Statistics of the run, see simPrintStats() */
+static struct
+{
+    unsigned long rounds;       /* Query commands */
+    unsigned long slots, empty, collisions;
+    unsigned long reads, crcErrors;
+    uint64_t firstQuery;        /* time of the first Query, 0 if none */
+    uint64_t lastRead;
+} stats_;
+
+/** The reply of the tags to the last command */
+struct simReply
+{
+    unsigned count;         /* number of tags replying, > 1 is a collision */
+    u8 buf[2 * (SIM_USERWORDS + 4)];
+    u8 len;                 /* data without CRC */
+    u8 crc;                 /* reply has a CRC-16 appended */
+    u8 header;              /* header bit of the reply, 1 is the error reply */
+    u8 hasHeader;           /* the reply starts with a header bit */
+    u8 delayed;
+    u8 rn16;                /* an RN16 reply, the chip stores it for ACKN */
+    u8 crcError;
+    u8 rssi;
+    u8 m, trext;            /* encoding of the replying tag */
+};
+
+static struct
+{
+    u8 reg[0x20];
+    u8 deep[0x20][3];
+    u8 fifo[24];
+    u8 fifoCount, fifoOverflow;
+    u8 irq;
+    u8 enabled;             /* ENABLE pin high */
+    /* bus */
+    u8 bus, addr, cont, deepIdx, fifoWritten;
+    /* transmitter */
+    u8 txCmd, txPending, txHave, txNeed;
+    u8 txBuf[80];
+    u16 txBits;
+    /* receiver */
+    u8 phase;
+    uint64_t eventAt;
+    struct simReply reply;
+    u8 rxPos, rxTotal, rxFull, rxBegun, rxHeaderDone;
+    uint64_t rxData;        /* cycle at which the first data bit starts */
+    uint64_t byteCycles;
+    uint64_t tpri;          /* link period in ns at the end of the last TX */
+    u8 rn16[2];
+    u8 rssi;
+} chip;
+
+static u8 inIsr_;
+
+/*------------------------------------------------------------------------- */
+/* helpers */
+/*------------------------------------------------------------------------- */
+
+static u16 simRandom(void)
+{
+    rand_ ^= rand_ << 13;
+    rand_ ^= rand_ >> 17;
+    rand_ ^= rand_ << 5;
+    return rand_ >> 8;
+}
+
+/** CRC-16 of Gen2, preset 0xffff, polynomial 0x1021, complemented */
+static u16 simCrc16(const u8 *buf, unsigned len)
+{
+    u16 crc = 0xffff;
+    unsigned i, b;
+
+    for (i = 0; i < len; i++)
+    {
+        crc ^= (u16)buf[i] << 8;
+        for (b = 0; b < 8; b++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return ~crc;
+}
+
+static u32 getBits(const u8 *buf, unsigned *pos, unsigned n)
+{
+    u32 val = 0;
+
+    while (n--)
+    {
+        val = (val << 1) | ((buf[*pos >> 3] >> (7 - (*pos & 7))) & 1);
+        (*pos)++;
+    }
+    return val;
+}
+
+static u32 getEbv(const u8 *buf, unsigned *pos)
+{
+    u32 val = 0;
+    u8 b;
+
+    do
+    {
+        b = getBits(buf, pos, 8);
+        val = (val << 7) | (b & 0x7f);
+    } while ((b & 0x80) && val < 0x1000000);
+    return val;
+}
+
+/** Tari in ns from AS399X_REG_PROTOCOLCTRL */
+static uint64_t tariNs(void)
+{
+    switch (chip.reg[AS399X_REG_PROTOCOLCTRL] & 3)
+    {
+    case 0: return 6250;
+    case 1: return 12500;
+    default: return 25000;
+    }
+}
+
+/** Backscatter link period in ns from AS399X_REG_RXOPTGEN2 */
+static uint64_t tpriNs(void)
+{
+    switch (chip.reg[AS399X_REG_RXOPTGEN2] >> 4)
+    {
+    case 0x0: return 25000;     /* 40 kHz */
+    case 0x3: return 12500;     /* 80 kHz */
+    case 0x6: return 6250;      /* 160 kHz */
+    case 0x8: return 4688;      /* 213 kHz */
+    case 0x9: return 3906;      /* 256 kHz */
+    case 0xC: return 3125;      /* 320 kHz */
+    case 0xF: return 1563;      /* 640 kHz */
+    default: return 6250;
+    }
+}
+
+static int rfOn(void)
+{
+    return chip.enabled && (chip.reg[AS399X_REG_STATUSCTRL] & 0x01);
+}
+
+/*------------------------------------------------------------------------- */
+/* tags */
+/*------------------------------------------------------------------------- */
+
+static u8 *tagBank(struct simTag *t, u8 bank, unsigned *words)
+{
+    switch (bank)
+    {
+    case 0: *words = sizeof(t->reserved) / 2; return t->reserved;
+    case 1: *words = SIM_EPCWORDS; return t->epc;
+    case 2: *words = SIM_TIDWORDS; return t->tid;
+    default: *words = SIM_USERWORDS; return t->user;
+    }
+}
+
+/** Words of PC and EPC as given by the length field of the PC */
+static unsigned tagPcEpcWords(const struct simTag *t)
+{
+    unsigned words = 1 + (t->epc[2] >> 3);
+
+    return (words > SIM_EPCWORDS - 1) ? SIM_EPCWORDS - 1 : words;
+}
+
+static void tagUpdateStoredCrc(struct simTag *t)
+{
+    u16 crc = simCrc16(t->epc + 2, 2 * tagPcEpcWords(t));
+
+    t->epc[0] = crc >> 8;
+    t->epc[1] = crc & 0xff;
+}
+
+void simTagsInit(unsigned count, unsigned seed, unsigned crcErrors)
+{
+    unsigned i, j;
+    struct simTag *t;
+
+    if (count > SIM_MAXTAGS) count = SIM_MAXTAGS;
+    numTags_ = count;
+    crcErrors_ = crcErrors;
+    rand_ = seed ? seed : 1;
+    memset(tags_, 0, sizeof(tags_));
+    for (i = 0; i < count; i++)
+    {
+        t = &tags_[i];
+        t->state = READY;
+        t->m = 1;
+        t->rssi = 0x40 | (simRandom() & 0x3f);
+        t->epc[2] = 0x30;           /* 96 bit EPC */
+        t->epc[3] = 0x00;
+        for (j = 4; j < 16; j++)
+            t->epc[j] = simRandom();
+        t->epc[14] = i >> 8;        /* keeps them distinct */
+        t->epc[15] = i & 0xff;
+        tagUpdateStoredCrc(t);
+        t->tid[0] = 0xE2; t->tid[1] = 0x80; t->tid[2] = 0x11; t->tid[3] = 0x05;
+        for (j = 4; j < sizeof(t->tid); j++)
+            t->tid[j] = simRandom();
+    }
+}
+
+/** Power loss of all tags when the carrier goes away */
+static void tagsPowerOff(void)
+{
+    unsigned i;
+
+    for (i = 0; i < numTags_; i++)
+    {
+        if (tags_[i].state != KILLED) tags_[i].state = READY;
+        tags_[i].inv[0] = 0;
+    }
+}
+
+static void tagNewRn16(struct simTag *t)
+{
+    t->rn16 = simRandom();
+}
+
+/** Queues the reply of tag t, data are len bytes at buf */
+static void tagReply(struct simTag *t, struct simReply *r, const u8 *buf, u8 len,
+                     u8 crc, u8 header)
+{
+    r->count++;
+    r->len = len;
+    memcpy(r->buf, buf, len);
+    r->crc = crc;
+    r->header = header;
+    r->rssi = t->rssi;
+    r->m = t->m;
+    r->trext = t->trext;
+}
+
+static void tagReplyRn16(struct simTag *t, struct simReply *r)
+{
+    u8 buf[2];
+
+    tagNewRn16(t);
+    buf[0] = t->rn16 >> 8;
+    buf[1] = t->rn16 & 0xff;
+    tagReply(t, r, buf, 2, 0, 0);
+    r->rn16 = 1;
+}
+
+/** Reply of the access commands: header, handle and CRC */
+static void tagReplyHandle(struct simTag *t, struct simReply *r, u8 delayed)
+{
+    u8 buf[2];
+
+    buf[0] = t->handle >> 8;
+    buf[1] = t->handle & 0xff;
+    tagReply(t, r, buf, 2, 1, 0);
+    r->hasHeader = delayed;
+    r->delayed = delayed;
+}
+
+static void tagReplyError(struct simTag *t, struct simReply *r, u8 errCode, u8 delayed)
+{
+    u8 buf[3];
+
+    buf[0] = errCode;
+    buf[1] = t->handle >> 8;
+    buf[2] = t->handle & 0xff;
+    tagReply(t, r, buf, 3, 1, 1);
+    r->hasHeader = 1;
+    r->delayed = delayed;
+}
+
+/** Invert the inventoried flag when leaving acknowledged, open or secured
+  * with a command of the same session */
+static void tagEndRound(struct simTag *t, u8 session)
+{
+    if ((t->state == ACKNOWLEDGED || t->state == OPEN || t->state == SECURED)
+        && session == t->session)
+    {
+        t->inv[session] ^= 1;
+        if (session == 1) t->s1SetAt = simCycles;
+    }
+    t->state = READY;
+}
+
+static void tagSetInv(struct simTag *t, u8 target, u8 value)
+{
+    if (target == 4)
+        t->sl = value;
+    else if (target < 4)
+    {
+        t->inv[target] = value;
+        if (target == 1) t->s1SetAt = simCycles;
+    }
+}
+
+static u8 tagGetInv(struct simTag *t, u8 target)
+{
+    if (target == 4) return t->sl;
+    if (target == 1 && t->inv[1] && simCycles - t->s1SetAt > SIM_US(SIM_S1_PERSISTENCE_US))
+        t->inv[1] = 0;
+    return target < 4 ? t->inv[target] : 0;
+}
+
+static void tagsSelect(const u8 *buf, unsigned pos, unsigned bits)
+{
+    u8 target, action, bank, len;
+    u32 ptr;
+    unsigned i, j, words, maskPos;
+    const u8 *mem;
+    struct simTag *t;
+    int match;
+
+    if (bits < pos + 3 + 3 + 2 + 8 + 8 + 1) return;
+    target = getBits(buf, &pos, 3);
+    action = getBits(buf, &pos, 3);
+    bank = getBits(buf, &pos, 2);
+    ptr = getEbv(buf, &pos);
+    len = getBits(buf, &pos, 8);
+    maskPos = pos;
+    if (bits < pos + len + 1) return;
+
+    for (i = 0; i < numTags_; i++)
+    {
+        t = &tags_[i];
+        if (t->state == KILLED) continue;
+        mem = tagBank(t, bank, &words);
+        match = (ptr + len <= words * 16);
+        for (j = 0, pos = maskPos; match && j < len; j++)
+        {
+            if (getBits(buf, &pos, 1) != ((mem[(ptr + j) >> 3] >> (7 - ((ptr + j) & 7))) & 1))
+                match = 0;
+        }
+        /* assert means SL set or inventoried A (0), deassert the opposite */
+        switch (action)
+        {
+        case 0: tagSetInv(t, target, target == 4 ? match : !match); break;
+        case 1: if (match) tagSetInv(t, target, target == 4); break;
+        case 2: if (!match) tagSetInv(t, target, target != 4); break;
+        case 3: if (match) tagSetInv(t, target, !tagGetInv(t, target)); break;
+        case 4: tagSetInv(t, target, target == 4 ? !match : match); break;
+        case 5: if (match) tagSetInv(t, target, target != 4); break;
+        case 6: if (!match) tagSetInv(t, target, target == 4); break;
+        case 7: if (!match) tagSetInv(t, target, !tagGetInv(t, target)); break;
+        }
+        t->state = READY;
+    }
+}
+
+static void tagsQuery(u8 m, u8 trext, u8 sel, u8 session, u8 target, u8 q, struct simReply *r)
+{
+    unsigned i;
+    struct simTag *t;
+
+    for (i = 0; i < numTags_; i++)
+    {
+        t = &tags_[i];
+        if (t->state == KILLED) continue;
+        tagEndRound(t, session);
+        if ((sel == 2 && t->sl) || (sel == 3 && !t->sl)) continue;
+        if (tagGetInv(t, session) != target) continue;
+        t->session = session;
+        t->q = q;
+        t->m = 1 << m;
+        t->trext = trext;
+        t->slot = simRandom() & ((1U << q) - 1);
+        t->state = ARBITRATE;
+        if (t->slot == 0)
+        {
+            t->state = REPLY;
+            tagReplyRn16(t, r);
+        }
+    }
+}
+
+static void tagsQueryRep(u8 session, struct simReply *r)
+{
+    unsigned i;
+    struct simTag *t;
+
+    for (i = 0; i < numTags_; i++)
+    {
+        t = &tags_[i];
+        if (t->session != session) continue;
+        switch (t->state)
+        {
+        case ARBITRATE:
+            t->slot = (t->slot - 1) & 0x7fff;
+            if (t->slot == 0)
+            {
+                t->state = REPLY;
+                tagReplyRn16(t, r);
+            }
+            break;
+        case REPLY:
+            t->slot = 0x7fff;
+            t->state = ARBITRATE;
+            break;
+        case ACKNOWLEDGED:
+        case OPEN:
+        case SECURED:
+            tagEndRound(t, session);
+            break;
+        }
+    }
+}
+
+static void tagsQueryAdjust(u8 session, u8 updn, struct simReply *r)
+{
+    unsigned i;
+    struct simTag *t;
+
+    for (i = 0; i < numTags_; i++)
+    {
+        t = &tags_[i];
+        if (t->session != session) continue;
+        switch (t->state)
+        {
+        case ARBITRATE:
+        case REPLY:
+            if (updn == 6 && t->q < 15) t->q++;
+            if (updn == 3 && t->q > 0) t->q--;
+            t->slot = simRandom() & ((1U << t->q) - 1);
+            t->state = ARBITRATE;
+            if (t->slot == 0)
+            {
+                t->state = REPLY;
+                tagReplyRn16(t, r);
+            }
+            break;
+        case ACKNOWLEDGED:
+        case OPEN:
+        case SECURED:
+            tagEndRound(t, session);
+            break;
+        }
+    }
+}
+
+static void tagsAck(u16 rn, struct simReply *r)
+{
+    unsigned i;
+    struct simTag *t;
+    u8 buf[2 * SIM_EPCWORDS];
+    unsigned len;
+
+    for (i = 0; i < numTags_; i++)
+    {
+        t = &tags_[i];
+        if (t->state != REPLY && t->state != ACKNOWLEDGED) continue;
+        if (t->rn16 != rn)
+        {
+            t->state = ARBITRATE;
+            continue;
+        }
+        t->state = ACKNOWLEDGED;
+        len = 2 * tagPcEpcWords(t);
+        memcpy(buf, t->epc + 2, len);
+        tagReply(t, r, buf, len, 1, 0);
+        /* crcErrors_ is the average over the uniform link quality 0 .. 63 */
+        if (crcErrors_ && simRandom() % 1000 * 63U < 2 * crcErrors_ * (63 - (t->rssi & 0x3f)))
+            r->crcError = 1;
+        if (r->crcError)
+            stats_.crcErrors++;
+        else
+        {
+            stats_.reads++;
+            stats_.lastRead = simCycles;
+            if (!t->firstRead) t->firstRead = simCycles;
+        }
+    }
+}
+
+static void tagsNak(void)
+{
+    unsigned i;
+
+    for (i = 0; i < numTags_; i++)
+    {
+        if (tags_[i].state >= REPLY && tags_[i].state <= SECURED) tags_[i].state = ARBITRATE;
+    }
+}
+
+/** The tag in open or secured state with the given handle, 0 if none */
+static struct simTag *tagByHandle(u16 handle)
+{
+    unsigned i;
+
+    for (i = 0; i < numTags_; i++)
+    {
+        if ((tags_[i].state == OPEN || tags_[i].state == SECURED) && tags_[i].handle == handle)
+            return &tags_[i];
+    }
+    return 0;
+}
+
+static void tagsReqRn(u16 rn, struct simReply *r)
+{
+    unsigned i;
+    struct simTag *t;
+    u8 buf[2];
+
+    for (i = 0; i < numTags_; i++)
+    {
+        t = &tags_[i];
+        if (t->state == ACKNOWLEDGED && t->rn16 == rn)
+        {
+            t->handle = simRandom();
+            t->state = (t->reserved[4] | t->reserved[5] | t->reserved[6] | t->reserved[7]) ? OPEN : SECURED;
+            buf[0] = t->handle >> 8;
+            buf[1] = t->handle & 0xff;
+            tagReply(t, r, buf, 2, 1, 0);
+        }
+        else if ((t->state == OPEN || t->state == SECURED) && t->handle == rn)
+        {
+            tagNewRn16(t);
+            buf[0] = t->rn16 >> 8;
+            buf[1] = t->rn16 & 0xff;
+            tagReply(t, r, buf, 2, 1, 0);
+        }
+    }
+}
+
+static void tagsRead(u8 bank, u32 ptr, u8 count, u16 handle, struct simReply *r)
+{
+    struct simTag *t = tagByHandle(handle);
+    unsigned words;
+    u8 *mem;
+    u8 buf[2 * SIM_USERWORDS + 2];
+
+    if (!t) return;
+    mem = tagBank(t, bank, &words);
+    if (count == 0 && ptr < words) count = words - ptr;
+    if (ptr + count > words)
+    {
+        tagReplyError(t, r, TAGERR_OVERRUN, 0);
+        return;
+    }
+    memcpy(buf, mem + 2 * ptr, 2 * count);
+    buf[2 * count] = handle >> 8;
+    buf[2 * count + 1] = handle & 0xff;
+    tagReply(t, r, buf, 2 * count + 2, 1, 0);
+    r->hasHeader = 1;
+}
+
+static void tagsWrite(u8 bank, u32 ptr, u8 count, const u8 *bytes, u8 cover,
+                      u16 handle, struct simReply *r)
+{
+    struct simTag *t = tagByHandle(handle);
+    unsigned words, i;
+    u8 *mem;
+
+    if (!t) return;
+    mem = tagBank(t, bank, &words);
+    if (count > SIM_BLOCKWRITE_MAX)
+    {
+        tagReplyError(t, r, TAGERR_NONSPECIFIC, 1);
+        return;
+    }
+    if (ptr + count > words)
+    {
+        tagReplyError(t, r, TAGERR_OVERRUN, 1);
+        return;
+    }
+    for (i = 0; i < 2 * count; i++)
+        mem[2 * ptr + i] = bytes[i] ^ (cover ? ((i & 1) ? t->rn16 & 0xff : t->rn16 >> 8) : 0);
+    if (bank == 1 && ptr + count > 1) tagUpdateStoredCrc(t);
+    tagReplyHandle(t, r, 1);
+}
+
+/** First or second half of the Kill or Access password */
+static int tagPasswordStep(struct simTag *t, u8 *step, const u8 *pw, u16 half)
+{
+    u16 expect = ((u16)pw[2 * *step] << 8) | pw[2 * *step + 1];
+
+    if ((half ^ t->rn16) != expect)
+    {
+        *step = 0;
+        t->state = ARBITRATE;
+        return -1;
+    }
+    return (*step)++;
+}
+
+static void tagsKill(u16 half, u16 handle, struct simReply *r)
+{
+    struct simTag *t = tagByHandle(handle);
+
+    if (!t) return;
+    if (!(t->reserved[0] | t->reserved[1] | t->reserved[2] | t->reserved[3]))
+    {
+        tagReplyError(t, r, TAGERR_OTHER, t->killStep);
+        t->killStep = 0;
+        return;
+    }
+    switch (tagPasswordStep(t, &t->killStep, t->reserved, half))
+    {
+    case 0:
+        tagReplyHandle(t, r, 0);
+        break;
+    case 1:
+        t->killStep = 0;
+        tagReplyHandle(t, r, 1);
+        t->state = KILLED;
+        break;
+    }
+}
+
+static void tagsAccess(u16 half, u16 handle, struct simReply *r)
+{
+    struct simTag *t = tagByHandle(handle);
+
+    if (!t) return;
+    switch (tagPasswordStep(t, &t->accessStep, t->reserved + 4, half))
+    {
+    case 0:
+        tagReplyHandle(t, r, 0);
+        break;
+    case 1:
+        t->accessStep = 0;
+        t->state = SECURED;
+        tagReplyHandle(t, r, 0);
+        break;
+    }
+}
+
+/** Counts the slot opened by Query, QueryRep or QueryAdjust */
+static void statsSlot(const struct simReply *r)
+{
+    stats_.slots++;
+    if (!r->count) stats_.empty++;
+    if (r->count > 1) stats_.collisions++;
+}
+
+static int compareCycles(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+void simPrintStats(void)
+{
+    static uint64_t firstReads[SIM_MAXTAGS];
+    unsigned i, n = 0;
+    double ms;
+
+    if (!stats_.rounds) return;
+    for (i = 0; i < numTags_; i++)
+    {
+        if (tags_[i].firstRead) firstReads[n++] = tags_[i].firstRead - stats_.firstQuery;
+    }
+    qsort(firstReads, n, sizeof(firstReads[0]), compareCycles);
+    ms = (double)(stats_.lastRead - stats_.firstQuery) * 1000 / SIM_CLK;
+    fprintf(stderr, "sim: %lu rounds, %lu slots, %.1f%% empty, %.1f%% collided\n",
+            stats_.rounds, stats_.slots, 100.0 * stats_.empty / stats_.slots,
+            100.0 * stats_.collisions / stats_.slots);
+    fprintf(stderr, "sim: %lu EPCs read, %lu with CRC error, %.1f reads/s in %.1fms virtual time\n",
+            stats_.reads, stats_.crcErrors, ms > 0 ? stats_.reads * 1000 / ms : 0, ms);
+    fprintf(stderr, "sim: %u of %u tags read", n, numTags_);
+    if (n)
+        fprintf(stderr, ", first read after 50%% %.2fms, 90%% %.2fms, 100%% %.2fms",
+                (double)firstReads[(n - 1) / 2] * 1000 / SIM_CLK,
+                (double)firstReads[(n - 1) * 9 / 10] * 1000 / SIM_CLK,
+                (double)firstReads[n - 1] * 1000 / SIM_CLK);
+    fprintf(stderr, "\n");
+}
+
+/** Evaluates the frame sent by the reader, bits long at buf */
+static void tagsCommand(const u8 *buf, unsigned bits, struct simReply *r)
+{
+    unsigned pos = 0;
+    u8 cmd, bank, count;
+    u32 ptr;
+    u16 val, handle;
+    u8 bytes[2 * 255];
+
+    memset(r, 0, sizeof(*r));
+    if (!rfOn() || bits < 4) return;
+
+    switch (buf[0] >> 4)
+    {
+    case 0x8: /* Query */
+        {
+            u8 m, trext, sel, session, target;
+
+            if (bits < 22) return;
+            pos = 4;
+            getBits(buf, &pos, 1);  /* DR */
+            m = getBits(buf, &pos, 2);
+            trext = getBits(buf, &pos, 1);
+            sel = getBits(buf, &pos, 2);
+            session = getBits(buf, &pos, 2);
+            target = getBits(buf, &pos, 1);
+            tagsQuery(m, trext, sel, session, target, getBits(buf, &pos, 4), r);
+            if (!stats_.firstQuery) stats_.firstQuery = simCycles;
+            stats_.rounds++;
+        }
+        statsSlot(r);
+        return;
+    case 0x9: /* QueryAdjust */
+        if (bits < 9) return;
+        pos = 4;
+        ptr = getBits(buf, &pos, 2);
+        tagsQueryAdjust(ptr, getBits(buf, &pos, 3), r);
+        statsSlot(r);
+        return;
+    case 0xA:
+        tagsSelect(buf, 4, bits);
+        return;
+    }
+    switch (buf[0] >> 6)
+    {
+    case 0: /* QueryRep */
+        pos = 2;
+        tagsQueryRep(getBits(buf, &pos, 2), r);
+        statsSlot(r);
+        return;
+    case 1: /* ACK */
+        if (bits < 18) return;
+        pos = 2;
+        tagsAck(getBits(buf, &pos, 16), r);
+        return;
+    }
+    if (bits < 8) return;
+    cmd = getBits(buf, &pos, 8);
+    switch (cmd)
+    {
+    case 0xC0: /* NAK */
+        tagsNak();
+        break;
+    case 0xC1: /* Req_RN */
+        if (bits >= 24) tagsReqRn(getBits(buf, &pos, 16), r);
+        break;
+    case 0xC2: /* Read */
+        bank = getBits(buf, &pos, 2);
+        ptr = getEbv(buf, &pos);
+        count = getBits(buf, &pos, 8);
+        if (pos + 16 <= bits) tagsRead(bank, ptr, count, getBits(buf, &pos, 16), r);
+        break;
+    case 0xC3: /* Write */
+        bank = getBits(buf, &pos, 2);
+        ptr = getEbv(buf, &pos);
+        bytes[0] = getBits(buf, &pos, 8);
+        bytes[1] = getBits(buf, &pos, 8);
+        if (pos + 16 <= bits) tagsWrite(bank, ptr, 1, bytes, 1, getBits(buf, &pos, 16), r);
+        break;
+    case 0xC4: /* Kill */
+        val = getBits(buf, &pos, 16);
+        getBits(buf, &pos, 3);
+        if (pos + 16 <= bits) tagsKill(val, getBits(buf, &pos, 16), r);
+        break;
+    case 0xC5: /* Lock */
+        getBits(buf, &pos, 20);
+        if (pos + 16 > bits) break;
+        handle = getBits(buf, &pos, 16);
+        if (tagByHandle(handle)) tagReplyHandle(tagByHandle(handle), r, 1);
+        break;
+    case 0xC6: /* Access */
+        val = getBits(buf, &pos, 16);
+        if (pos + 16 <= bits) tagsAccess(val, getBits(buf, &pos, 16), r);
+        break;
+    case 0xC7: /* BlockWrite */
+        bank = getBits(buf, &pos, 2);
+        ptr = getEbv(buf, &pos);
+        count = getBits(buf, &pos, 8);
+        if (pos + 16 * count + 16 > bits) break;
+        for (val = 0; val < 2 * count && val < sizeof(bytes); val++)
+            bytes[val] = getBits(buf, &pos, 8);
+        tagsWrite(bank, ptr, count, bytes, 0, getBits(buf, &pos, 16), r);
+        break;
+    }
+}
+
+/*------------------------------------------------------------------------- */
+/* chip */
+/*------------------------------------------------------------------------- */
+
+static void chipIrq(u8 flags)
+{
+    chip.irq |= flags;
+}
+
+static void fifoPush(u8 b)
+{
+    if (chip.fifoCount >= sizeof(chip.fifo))
+    {
+        chip.fifoOverflow = 1;
+        chipIrq(AS399X_IRQ_FIFO);
+        return;
+    }
+    chip.fifo[chip.fifoCount++] = b;
+    if (chip.fifoCount == AS399X_HIGHFIFOLEVEL) chipIrq(AS399X_IRQ_FIFO);
+}
+
+static u8 fifoPop(void)
+{
+    u8 b;
+
+    if (!chip.fifoCount) return 0;
+    b = chip.fifo[0];
+    chip.fifoCount--;
+    memmove(chip.fifo, chip.fifo + 1, chip.fifoCount);
+    return b;
+}
+
+static void chipReset(void)
+{
+    memset(chip.reg, 0, sizeof(chip.reg));
+    memset(chip.deep, 0, sizeof(chip.deep));
+    chip.reg[AS399X_REG_RXNORESPWAIT] = 0x1B;
+    chip.reg[AS399X_REG_IRQMASKREG] = AS399X_IRQ_MASK_ALL;
+    chip.deep[AS399X_REG_PLLMAIN][2] = 0x60;
+    chip.fifoCount = chip.fifoOverflow = 0;
+    chip.irq = 0;
+    chip.bus = BUS_IDLE;
+    chip.txPending = 0;
+    chip.phase = PHASE_IDLE;
+    tagsPowerOff();
+}
+
+/** Starts the transmission of the frame in txBuf */
+static void chipTransmit(u8 query)
+{
+    uint64_t ns = tariNs() * (chip.txBits * 11 / 8 + 6 + (query ? 8 : 0));
+
+    chip.txPending = 0;
+    chip.phase = PHASE_TX;
+    chip.eventAt = simCycles + SIM_NS(ns);
+}
+
+/** Frame of a direct command, in bits */
+static void chipDirectFrame(u32 bits, u8 len)
+{
+    bits <<= 32 - len;
+    chip.txBuf[0] = bits >> 24;
+    chip.txBuf[1] = bits >> 16;
+    chip.txBuf[2] = bits >> 8;
+    chip.txBuf[3] = bits;
+    chip.txBits = len;
+}
+
+/** Data for the pending TX has been written to the FIFO */
+static void chipFeedTransmitter(void)
+{
+    u16 len;
+    u8 n;
+
+    if (!chip.txPending) return;
+    if (chip.txCmd == AS399X_CMD_QUERY)
+    {
+        if (chip.fifoCount < 2) return;
+        /* 1000 DR M TRext Sel Session Target Q */
+        chip.txBuf[0] = 0x80 | ((chip.fifo[0] >> 2) & 0x0f);
+        chip.txBuf[1] = (chip.fifo[0] << 6) | (chip.fifo[1] >> 2);
+        chip.txBuf[2] = chip.fifo[1] << 6;
+        chip.txBits = 22;
+        chip.fifoCount = 0;
+        chipTransmit(1);
+        return;
+    }
+    len = ((u16)chip.reg[AS399X_REG_TXLENGTHUP] << 8) | chip.reg[AS399X_REG_TXLENGTHLOW];
+    chip.txNeed = (len >> 4) + (len & 1);
+    chip.txBits = (len >> 4) * 8 + ((len & 1) ? (len >> 1) & 7 : 0);
+    n = chip.fifoCount;
+    if (n > chip.txNeed - chip.txHave) n = chip.txNeed - chip.txHave;
+    if (chip.txHave + n > sizeof(chip.txBuf)) n = sizeof(chip.txBuf) - chip.txHave;
+    memcpy(chip.txBuf + chip.txHave, chip.fifo, n);
+    chip.txHave += n;
+    chip.fifoCount -= n;
+    memmove(chip.fifo, chip.fifo + n, chip.fifoCount);
+    if (chip.txHave >= chip.txNeed)
+        chipTransmit(0);
+    else if (n)
+        chipIrq(AS399X_IRQ_FIFO); /* running low */
+}
+
+static void chipCommand(u8 cmd)
+{
+    u8 session = chip.reg[AS399X_REG_TXOPTGEN2] & 3;
+
+    switch (cmd)
+    {
+    case AS399X_CMD_IDLE:
+        chip.phase = PHASE_IDLE;
+        chip.txPending = 0;
+        break;
+    case AS399X_CMD_SOFTINIT:
+        chipReset();
+        break;
+    case AS399X_CMD_RESETFIFO:
+        chip.fifoCount = chip.fifoOverflow = 0;
+        break;
+    case AS399X_CMD_TRANSMCRC:
+    case AS399X_CMD_TRANSMCRCEHEAD:
+    case AS399X_CMD_TRANSM:
+    case AS399X_CMD_DELAYEDTRANSM:
+    case AS399X_CMD_DELAYEDTRANSMCRC:
+    case AS399X_CMD_QUERY:
+        chip.txCmd = cmd;
+        chip.txPending = 1;
+        chip.txHave = 0;
+        chip.phase = PHASE_IDLE;
+        break;
+    case AS399X_CMD_BLOCKRX:
+        if (chip.phase == PHASE_WAIT || chip.phase == PHASE_RX) chip.phase = PHASE_IDLE;
+        break;
+    case AS399X_CMD_QUERYREP:
+        chipDirectFrame(session, 4);
+        chipTransmit(0);
+        break;
+    case AS399X_CMD_QUERYADJUSTUP:
+    case AS399X_CMD_QUERYADJUSTNIC:
+    case AS399X_CMD_QUERYADJUSTDOWN:
+        chipDirectFrame(0x120 | (session << 3) | (cmd == AS399X_CMD_QUERYADJUSTUP ? 6 :
+                        cmd == AS399X_CMD_QUERYADJUSTDOWN ? 3 : 0), 9);
+        chipTransmit(0);
+        break;
+    case AS399X_CMD_ACKN:
+        chipDirectFrame(0x10000 | ((u32)chip.rn16[0] << 8) | chip.rn16[1], 18);
+        chipTransmit(0);
+        break;
+    case AS399X_CMD_NAK:
+        chipDirectFrame(0xC0, 8);
+        chipTransmit(0);
+        break;
+    case AS399X_CMD_REQRN:
+        chipDirectFrame(0xC10000 | ((u32)chip.rn16[0] << 8) | chip.rn16[1], 24);
+        chipTransmit(0);
+        break;
+    }
+}
+
+/** The transmission has ended, the tags reply or not */
+static void chipTxDone(void)
+{
+    uint64_t tpri = tpriNs();
+    uint64_t wait;
+
+    chip.tpri = tpri;
+    chipIrq(AS399X_IRQ_TX);
+    tagsCommand(chip.txBuf, chip.txBits, &chip.reply);
+    chip.phase = PHASE_WAIT;
+    if (chip.reply.count)
+        wait = chip.reply.delayed ? SIM_DELAYED_US * 1000ULL : 10 * tpri + 2000;
+    else if (chip.reg[AS399X_REG_IRQMASKREG] & AS399X_IRQ_NORESP)
+        wait = (chip.reg[AS399X_REG_RXNORESPWAIT] ? chip.reg[AS399X_REG_RXNORESPWAIT] : 1) * 25600ULL;
+    else
+    {
+        chip.phase = PHASE_IDLE; /* wait forever */
+        return;
+    }
+    chip.eventAt += SIM_NS(wait);
+}
+
+/** A reply begins or no response timeout */
+static void chipRxStart(void)
+{
+    struct simReply *r = &chip.reply;
+    uint64_t tpri = chip.tpri;
+    uint64_t preamble;
+
+    if (!r->count)
+    {
+        chipIrq(AS399X_IRQ_NORESP);
+        chip.phase = PHASE_IDLE;
+        return;
+    }
+    preamble = (r->m == 1) ? (r->trext ? 18 : 6) * tpri : ((r->trext ? 16 : 4) + 6) * r->m * tpri;
+    chip.phase = PHASE_RX;
+    chip.rxBegun = 0;
+    if (r->count > 1)
+    {
+        chip.eventAt += SIM_NS(preamble);
+        return;
+    }
+    chip.rxFull = (chip.reg[AS399X_REG_RXLENGTHUP] & 0x40) != 0;
+    if (r->crc)
+    {
+        u16 crc = simCrc16(r->buf, r->len);
+
+        r->buf[r->len] = crc >> 8;
+        r->buf[r->len + 1] = crc & 0xff;
+    }
+    chip.rxTotal = r->len + (r->crc ? 2 : 0);
+    chip.rxPos = 0;
+    chip.rxHeaderDone = 0;
+    chip.byteCycles = SIM_NS(8 * r->m * tpri);
+    chip.rxData = chip.eventAt + SIM_NS(preamble + (r->hasHeader ? r->m * tpri : 0));
+    chip.eventAt = chip.rxData;
+    if (r->rn16)
+    {
+        chip.rn16[0] = r->buf[0];
+        chip.rn16[1] = r->buf[1];
+    }
+    chip.rssi = r->rssi;
+}
+
+/** Start of the data, next byte of the reply or its end */
+static void chipRxByte(void)
+{
+    struct simReply *r = &chip.reply;
+
+    if (r->count > 1)
+    {
+        chipIrq(AS399X_IRQ_PREAMBLE);
+        chip.phase = PHASE_IDLE;
+        return;
+    }
+    if (!chip.rxBegun)
+    {
+        chip.rxBegun = 1;
+        chip.rxHeaderDone = r->header;
+        if (r->header) chipIrq(AS399X_IRQ_HEADER);
+        chip.eventAt = chip.rxData + chip.byteCycles;
+        return;
+    }
+    if (chip.rxPos < chip.rxTotal)
+    {
+        if (chip.rxFull || chip.rxPos < r->len) fifoPush(r->buf[chip.rxPos]);
+        chip.rxPos++;
+        if (chip.rxFull && chip.rxPos == 2 && !chip.rxHeaderDone)
+        { /* got something */
+            chipIrq(AS399X_IRQ_HEADER);
+            chip.rxHeaderDone = 1;
+        }
+        chip.eventAt = chip.rxData + (chip.rxPos + 1) * chip.byteCycles;
+        if (chip.rxPos == chip.rxTotal) /* dummy bit */
+            chip.eventAt = chip.rxData + chip.rxPos * chip.byteCycles + chip.byteCycles / 8;
+        return;
+    }
+    chipIrq(AS399X_IRQ_RX | (r->crcError ? AS399X_IRQ_CRCERROR : 0));
+    chip.phase = PHASE_IDLE;
+}
+
+/** Processes the events which are due */
+static void chipRun(void)
+{
+    if (chip.enabled != (ENABLE != 0))
+    {
+        chip.enabled = (ENABLE != 0);
+        chipReset();
+    }
+    while (chip.phase != PHASE_IDLE && chip.eventAt <= simCycles)
+    {
+        switch (chip.phase)
+        {
+        case PHASE_TX: chipTxDone(); break;
+        case PHASE_WAIT: chipRxStart(); break;
+        case PHASE_RX: chipRxByte(); break;
+        }
+    }
+}
+
+static int chipIrqLine(void)
+{
+    return chip.enabled && (chip.irq & (chip.reg[AS399X_REG_IRQMASKREG] | AS399X_IRQ_TX | AS399X_IRQ_RX));
+}
+
+static u8 chipRead(u8 addr)
+{
+    u8 val;
+
+    switch (addr)
+    {
+    case AS399X_REG_IRQSTATUS:
+        val = chip.irq;
+        chip.irq = 0;
+        return val;
+    case AS399X_REG_AGCINTERNALSTATUS:
+        return 0x03 | (rfOn() ? 0x04 : 0);
+    case AS399X_REG_RSSILEVELS:
+        return chip.rssi;
+    case AS399X_REG_AGLSTATUS:
+        return 0x03;
+    case AS399X_REG_VERSION:
+        return 0x51;
+    case AS399X_REG_FIFOSTATUS:
+        return chip.fifoCount | (chip.fifoOverflow ? AS399X_FIFOSTAT_OVERFLOW : 0);
+    case AS399X_REG_FIFO:
+        return fifoPop();
+    default:
+        return chip.reg[addr];
+    }
+}
+
+static void chipWrite(u8 addr, u8 val)
+{
+    switch (addr)
+    {
+    case AS399X_REG_STATUSCTRL:
+        if ((chip.reg[addr] & 0x01) && !(val & 0x01)) tagsPowerOff();
+        chip.reg[addr] = val;
+        break;
+    case AS399X_REG_IRQSTATUS:
+    case AS399X_REG_AGCINTERNALSTATUS:
+    case AS399X_REG_AGLSTATUS:
+    case AS399X_REG_VERSION:
+    case AS399X_REG_FIFOSTATUS:
+        break;
+    case AS399X_REG_FIFO:
+        fifoPush(val);
+        chip.fifoWritten = 1;
+        break;
+    default:
+        chip.reg[addr] = val;
+    }
+}
+
+static int isDeep(u8 addr)
+{
+    return addr == AS399X_REG_TESTSETTING || (addr >= AS399X_REG_CLSYSAOCPCTRL && addr <= AS399X_REG_PLLAUX);
+}
+
+/** Moves on to the next register after a byte has been transferred */
+static void busNext(void)
+{
+    if (isDeep(chip.addr) && ++chip.deepIdx < 3) return;
+    chip.deepIdx = 0;
+    if (!chip.cont)
+        chip.bus = BUS_ADDR;
+    else if (chip.addr != AS399X_REG_FIFO && chip.addr != AS399X_REG_VERSION)
+        chip.addr++; /* the pre-distortion table is written behind VERSION */
+}
+
+/*------------------------------------------------------------------------- */
+/* interface of as399x_com.h */
+/*------------------------------------------------------------------------- */
+
+void initInterface(void)
+{
+    EN(HIGH);
+    EX0 = 1;
+    EA = 1;
+    chipRun();
+}
+
+void setPortDirect()
+{
+}
+
+void setPortNormal()
+{
+}
+
+void writeReadAS399x( const u8* wbuf, u8 wlen, u8* rbuf, u8 rlen, u8 stopMode, u8 doStart )
+{
+    u8 b;
+
+    simAdvance(SIM_ACCESS_CYCLES + (wlen + rlen) * SIM_BYTE_CYCLES);
+    if (!chip.enabled)
+    {
+        if (rbuf) memset(rbuf, 0, rlen);
+        return;
+    }
+    if (doStart)
+    {
+        chip.bus = BUS_ADDR;
+        chip.fifoWritten = 0;
+    }
+    while (wlen--)
+    {
+        b = *wbuf++;
+        switch (chip.bus)
+        {
+        case BUS_ADDR:
+            if (b & 0x80)
+            {
+                chipCommand(b);
+                break;
+            }
+            chip.addr = b & 0x1f;
+            chip.cont = (b & 0x20) != 0;
+            chip.deepIdx = 0;
+            chip.bus = (b & 0x40) ? BUS_READ : BUS_WRITE;
+            break;
+        case BUS_WRITE:
+            if (isDeep(chip.addr))
+                chip.deep[chip.addr][chip.deepIdx] = b;
+            else
+                chipWrite(chip.addr, b);
+            busNext();
+            break;
+        default:
+            break;
+        }
+    }
+    while (rlen-- && rbuf)
+    {
+        if (chip.bus != BUS_READ)
+        {
+            *rbuf++ = 0;
+            continue;
+        }
+        *rbuf++ = isDeep(chip.addr) ? chip.deep[chip.addr][chip.deepIdx] : chipRead(chip.addr);
+        if (isDeep(chip.addr) || chip.cont) busNext();
+    }
+    if (stopMode != STOP_NONE)
+    {
+        chip.bus = BUS_IDLE;
+        if (chip.fifoWritten || (chip.txPending && chip.txCmd != AS399X_CMD_QUERY))
+            chipFeedTransmitter();
+        chip.fifoWritten = 0;
+    }
+}
+
+void writeReadAS399xIsr( const u8 wbuf, u8* rbuf )
+{
+    *rbuf = chip.enabled ? chipRead(wbuf & 0x1f) : 0;
+}
+
+/*------------------------------------------------------------------------- */
+/* virtual clock */
+/*------------------------------------------------------------------------- */
+
+uint64_t simCycles;
+
+uint64_t simNextEvent(void)
+{
+    return chip.phase != PHASE_IDLE ? chip.eventAt : 0;
+}
+
+/** Runs the interrupt service routine while the line is active and the
+  * interrupt is enabled, returns 1 if it did */
+static int simDeliver(void)
+{
+    int done = 0;
+
+    while (!inIsr_ && EX0 && EA && chipIrqLine())
+    {
+        inIsr_ = 1;
+        extInt();
+        inIsr_ = 0;
+        done = 1;
+    }
+    return done;
+}
+
+/** Advances the clock to target, stops early after an interrupt if stopAtIrq */
+static int simRunTo(uint64_t target, int stopAtIrq)
+{
+    uint64_t next;
+    int irq = 0;
+
+    for (;;)
+    {
+        chipRun();
+        irq |= simDeliver();
+        if ((irq && stopAtIrq) || simCycles >= target) break;
+        next = simNextEvent();
+        simCycles = (next && next < target) ? next : target;
+    }
+    return irq;
+}
+
+void simAdvance(uint64_t cycles)
+{
+    simRunTo(simCycles + cycles, 0);
+}
+
+/** Advances to target or until the AS399x has interrupted, see hw.c */
+int simAdvanceUntilIrq(uint64_t target)
+{
+    return simRunTo(target, 1);
+}
+
+void simExtIrq(void)
+{
+    chipRun();
+    simDeliver();
+}
+
+void simBusyWait(void)
+{
+    uint64_t next = simNextEvent();
+
+    if (next > simCycles)
+        simAdvanceUntilIrq(next);
+    else
+        simAdvance(8);
+}
@@ -0,0 +1,60 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Special function registers for the host build.
+  *
+  * The registers of ../c8051F340.h become plain variables (sfr.h is
+  * generated from it by the Makefile, bits of bit addressable registers are
+  * separate variables). The registers which move on their own on the
+  * target are accessed through hw.c, which advances the virtual clock
+  * on every access:
+  *  - TL0 counts SYSCLK, TH0, PCA0L and PCA0H count its overflows
+  *  - TMR3CN sets TF3H (0x80) when timer 3 overflows
+  *  - PCON lets the host sleep once the firmware went idle
+  */
+
+#ifndef C8051F340_H
+#define C8051F340_H
+
+#define SFR(name) extern volatile unsigned char name
+#include "sfr.h"
+#undef SFR
+
+extern volatile unsigned char *simClockSfr(volatile unsigned char *reg);
+extern volatile unsigned char *simTimer3Sfr(volatile unsigned char *reg);
+extern volatile unsigned char *simIdleSfr(volatile unsigned char *reg);
+
+#define TL0     (*simClockSfr(&TL0))
+#define TH0     (*simClockSfr(&TH0))
+#define PCA0L   (*simClockSfr(&PCA0L))
+#define PCA0H   (*simClockSfr(&PCA0H))
+#define TMR3CN  (*simTimer3Sfr(&TMR3CN))
+#define PCON    (*simIdleSfr(&PCON))
+
+/** Delivers a pending AS399x interrupt once EX0 is set, see ENEXTIRQ() */
+extern void simExtIrq(void);
+/** Advances the virtual clock in busy wait loops which do not access any register */
+extern void simBusyWait(void);
+/** Advances the virtual clock to the next slow tick, see SLOWTICKWAIT() */
+extern void simSlowTickWait(void);
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Entry point of the host build.
+  *
+  * Usage: cottonwood [-n tags] [-s seed] [-e permille] [-l link] [-q]
+  *
+  * Creates the simulated tag population, opens the pseudo terminal the
+  * commands are served on and runs the main() of the firmware, which is
+  * renamed to firmwareMain() by the Makefile. The statistics of the tag
+  * population are printed when it is terminated.
+  */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+
+#include "sim.h"
+
+int simQuiet;
+
+static const char *link_;
+
+/* Terminates through exit() so that the link is removed and profiling
+   data is written. */
+static void hostTerminate(int sig)
+{
+    (void)sig;
+    if (link_) unlink(link_);
+    exit(0);
+}
+
+extern void firmwareMain(void);
+
+int main(int argc, char *argv[])
+{
+    unsigned tags = 20, seed = 1, crcErrors = 0;
+    const char *link = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:s:e:l:q")) != -1)
+    {
+        switch (opt)
+        {
+        case 'n': tags = strtoul(optarg, 0, 0); break;
+        case 's': seed = strtoul(optarg, 0, 0); break;
+        case 'e': crcErrors = strtoul(optarg, 0, 0); break;
+        case 'l': link = optarg; break;
+        case 'q': simQuiet = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-n tags] [-s seed] [-e permille] [-l link] [-q]\n", argv[0]);
+            return 1;
+        }
+    }
+    simTagsInit(tags, seed, crcErrors);
+    simUartOpen(link);
+    link_ = link;
+    atexit(simPrintStats);
+    signal(SIGINT, hostTerminate);
+    signal(SIGTERM, hostTerminate);
+    firmwareMain();
+    return 0;
+}
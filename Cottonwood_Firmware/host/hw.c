@@ -0,0 +1,179 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Special function registers, flash and USB stubs of the host build.
+  *
+  * Defines the registers declared by c8051F340.h. The timers follow the
+  * virtual clock of sim.h, see there. The flash primitives work on
+  * simFlash, which starts erased. The USB stack is not part of the host
+  * build (UARTSUPPORT is set), only the buffers usb_commands.c shares with
+  * it are defined here.
+  */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "keil.h"
+#include "sim.h"
+#include "c8051F340.h"
+#include "global.h"
+#include "F340_FlashPrimitives.h"
+#include "F3xx_USB0_ReportHandler.h"
+
+#undef TL0
+#undef TH0
+#undef PCA0L
+#undef PCA0H
+#undef TMR3CN
+#undef PCON
+
+#define SFR(name) volatile unsigned char name
+#include "sfr.h"
+#undef SFR
+
+/** Cycles a register access in a polling loop takes */
+#define SIM_POLL_CYCLES         12
+/** Timer 3 counts SYSCLK / 12, see timerStart_us() */
+#define SIM_TIMER3_DIV          12
+/** Largest step of the virtual clock on an access to timer 3 */
+#define SIM_TIMER3_STEP         SIM_US(1)
+
+unsigned char simFlash[0x10000];
+
+unsigned char xdata IN_PACKET[64];
+unsigned char xdata OUT_PACKET[64];
+xdata unsigned char getBuffer_[64];
+BufferStructure IN_BUFFER, OUT_BUFFER;
+
+static int timer3Running_;
+static uint64_t timer3Overflow_;
+static int idlePending_;
+
+/** Update of timer 0 and the PCA from the virtual clock */
+static void simClockUpdate(void)
+{
+    TL0 = simCycles;
+    TH0 = simCycles >> 8;
+    PCA0L = simCycles >> 16;
+    PCA0H = simCycles >> 24;
+}
+
+/** Idle mode of schedRun(): PCON was set, timer 0 or the PCA are read next.
+  * Sleeps until the host sends something or the virtual clock reached the
+  * next timer 0 overflow. */
+static void simIdle(void)
+{
+    uint64_t next = (simCycles | 0xffff) + 1;
+
+    idlePending_ = 0;
+    if (!(PCON & 0x01)) return;
+    PCON &= ~0x01;
+    if (simUartWait((int)((next - simCycles) * 1000 / SIM_CLK) + 1))
+        simAdvance(SIM_POLL_CYCLES);
+    else
+        simAdvanceUntilIrq(next);
+}
+
+volatile unsigned char *simClockSfr(volatile unsigned char *reg)
+{
+    if (idlePending_) simIdle();
+    simAdvance(SIM_POLL_CYCLES);
+    simClockUpdate();
+    return reg;
+}
+
+volatile unsigned char *simTimer3Sfr(volatile unsigned char *reg)
+{
+    unsigned count;
+
+    if (!(TMR3CN & 0x04))
+    {
+        timer3Running_ = 0;
+        return reg;
+    }
+    if (!timer3Running_)
+    { /* started since the last access */
+        timer3Running_ = 1;
+        count = ((unsigned)TMR3H << 8) | TMR3L;
+        timer3Overflow_ = simCycles + (0x10000 - count) * SIM_TIMER3_DIV;
+    }
+    if (!(TMR3CN & 0x80))
+    { /* polled for the overflow, move on in steps of SIM_TIMER3_STEP as
+         writes cannot be told from reads */
+        simAdvanceUntilIrq(simCycles + SIM_TIMER3_STEP < timer3Overflow_ ?
+                           simCycles + SIM_TIMER3_STEP : timer3Overflow_);
+        if (simCycles >= timer3Overflow_)
+        {
+            TMR3CN |= 0x80;
+            count = ((unsigned)TMR3RLH << 8) | TMR3RLL;
+            timer3Overflow_ += (0x10000 - count) * SIM_TIMER3_DIV;
+        }
+    }
+    else
+        simAdvance(SIM_POLL_CYCLES);
+    return reg;
+}
+
+void simSlowTickWait(void)
+{
+    simAdvanceUntilIrq((simCycles | 0xffff) + 1);
+}
+
+volatile unsigned char *simIdleSfr(volatile unsigned char *reg)
+{
+    idlePending_ = 1;
+    return reg;
+}
+
+void FLASH_ByteWrite(FLADDR addr, char byte)
+{
+    simFlash[addr & 0xffff] &= byte;
+}
+
+unsigned char FLASH_ByteRead(FLADDR addr)
+{
+    return simFlash[addr & 0xffff];
+}
+
+void FLASH_PageErase(FLADDR addr)
+{
+    memset(simFlash + (addr & 0xffff & ~(FLASH_PAGESIZE - 1)), 0xff, FLASH_PAGESIZE);
+}
+
+void System_Init(void)
+{
+    memset(simFlash, 0xff, sizeof(simFlash));
+}
+
+void Usb_Init(void)
+{
+}
+
+/* Commands come in through uart.c, the USB receive flag is never set. */
+unsigned char getReceiveFlag(void)
+{
+    return 0;
+}
+
+void resetUSBReceiveFlag(void)
+{
+}
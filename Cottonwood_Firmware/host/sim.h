@@ -0,0 +1,72 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Declarations shared by the files of the host build.
+  *
+  * The host build runs the firmware on a virtual clock counted in SYSCLK
+  * cycles. It only advances where the target would spend time, i.e. on
+  * accesses to the AS399x and to the timer registers and in busy wait
+  * loops. Pending AS399x interrupts are delivered at the same points.
+  */
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+
+/** SYSCLK of the target, see CLK in global.h */
+#define SIM_CLK                 48000000ULL
+/** Converts microseconds into SYSCLK cycles */
+#define SIM_US(us)              ((uint64_t)(us) * SIM_CLK / 1000000ULL)
+/** Converts nanoseconds into SYSCLK cycles */
+#define SIM_NS(ns)              ((uint64_t)(ns) * SIM_CLK / 1000000000ULL)
+
+/** Virtual time in SYSCLK cycles */
+extern uint64_t simCycles;
+/** Set by -q, CON_print() output is dropped */
+extern int simQuiet;
+/** Code flash of the target, see F340_FlashPrimitives.h */
+extern unsigned char simFlash[0x10000];
+
+/** Advances the virtual clock by cycles, the AS399x model follows and
+  * pending interrupts are delivered. */
+void simAdvance(uint64_t cycles);
+/** Advances the virtual clock to target or until an AS399x interrupt has
+  * been delivered, returns 1 in the latter case */
+int simAdvanceUntilIrq(uint64_t target);
+/** Cycle at which the AS399x model has its next event, 0 if none */
+uint64_t simNextEvent(void);
+/** Creates the tag population: count tags (up to 10000) with random EPCs
+  * and RSSI from seed. On average crcErrors EPC replies out of 1000 are
+  * received with CRC error, more of the weak tags and fewer of the strong. */
+void simTagsInit(unsigned count, unsigned seed, unsigned crcErrors);
+/** Prints slot usage, reads/s and the time until the tags were read first,
+  * counted in virtual time from the first Query, to stderr */
+void simPrintStats(void);
+
+/** Opens the pseudo terminal, prints its name and creates link to it if not 0 */
+void simUartOpen(const char *link);
+/** Waits up to ms milliseconds of real time for data from the host,
+  * returns 1 if there is some */
+int simUartWait(int ms);
+
+#endif
@@ -0,0 +1,228 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Host replacement of uart.c, the UART is a pseudo terminal.
+  *
+  * Received bytes are read from the master side of the pty without
+  * blocking. checkByte() looks at the pty at most once per received byte
+  * time (or every SIM_UART_POLL_CALLS calls) so that the firmware, which
+  * polls for aborts in its inner loops, does not spend its time in system
+  * calls. Transmitted bytes cost their byte time on the virtual clock and
+  * are collected until the next poll or until the buffer is full.
+  */
+
+#define _DEFAULT_SOURCE
+#define _XOPEN_SOURCE 600
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+
+#include "keil.h"
+#include "sim.h"
+#include "global.h"
+#include "uart.h"
+
+/** Cycles for one byte at 115200 baud, 8N1, see initUART() in uart.c */
+#define SIM_UART_BYTE_CYCLES    SIM_US(87)
+/** checkByte() calls after which the pty is polled regardless of time */
+#define SIM_UART_POLL_CALLS     64
+
+static int fd_ = -1;
+static int slaveFd_ = -1;
+static unsigned char rxBuf_[256];
+static unsigned rxHead_, rxTail_;
+static unsigned char txBuf_[1024];
+static unsigned txLen_;
+static uint64_t lastPoll_;
+static unsigned pollCalls_;
+
+static void uartFlush(void)
+{
+    unsigned done = 0;
+    ssize_t n;
+
+    while (done < txLen_)
+    {
+        n = write(fd_, txBuf_ + done, txLen_ - done);
+        if (n <= 0)
+        {
+            struct pollfd p = { fd_, POLLOUT, 0 };
+            if (poll(&p, 1, 100) <= 0) break; /* nobody reads, drop it */
+            continue;
+        }
+        done += n;
+    }
+    txLen_ = 0;
+}
+
+static void uartPoll(void)
+{
+    ssize_t n;
+
+    lastPoll_ = simCycles;
+    pollCalls_ = 0;
+    if (txLen_) uartFlush();
+    if (rxHead_ != rxTail_) return;
+    rxHead_ = rxTail_ = 0;
+    n = read(fd_, rxBuf_, sizeof(rxBuf_));
+    if (n > 0) rxTail_ = n;
+}
+
+void simUartOpen(const char *link)
+{
+    struct termios tio;
+    const char *name;
+
+    fd_ = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd_ < 0 || grantpt(fd_) || unlockpt(fd_) || !(name = ptsname(fd_)))
+    {
+        perror("pty");
+        exit(1);
+    }
+    /* Keep the slave open, otherwise the master reads EIO whenever the
+       host closes it. */
+    slaveFd_ = open(name, O_RDWR | O_NOCTTY);
+    if (slaveFd_ < 0 || tcgetattr(slaveFd_, &tio))
+    {
+        perror(name);
+        exit(1);
+    }
+    cfmakeraw(&tio);
+    tcsetattr(slaveFd_, TCSANOW, &tio);
+    fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) | O_NONBLOCK);
+    if (link)
+    {
+        unlink(link);
+        if (symlink(name, link))
+        {
+            perror(link);
+            exit(1);
+        }
+    }
+    printf("%s\n", name);
+    fflush(stdout);
+}
+
+int simUartWait(int ms)
+{
+    struct pollfd p = { fd_, POLLIN, 0 };
+
+    if (txLen_) uartFlush();
+    if (rxHead_ != rxTail_) return 1;
+    if (poll(&p, 1, ms) <= 0) return 0;
+    uartPoll();
+    return rxHead_ != rxTail_;
+}
+
+void initUART(void)
+{
+    rxHead_ = rxTail_ = 0;
+    txLen_ = 0;
+}
+
+void sendArrayN(char *dat, u8 n)
+{
+    while (n--) sendByte(*dat++);
+}
+
+void sendArray(char *dat)
+{
+    sendArrayN(dat, strlen(dat));
+}
+
+void sendByte(u8 value)
+{
+    if (txLen_ >= sizeof(txBuf_)) uartFlush();
+    txBuf_[txLen_++] = value;
+    simAdvance(SIM_UART_BYTE_CYCLES);
+}
+
+void waitForData(void)
+{
+    while (!checkByte()) simUartWait(1);
+}
+
+u8 checkByte(void)
+{
+    if (rxHead_ == rxTail_ &&
+        (simCycles - lastPoll_ >= SIM_UART_BYTE_CYCLES ||
+         ++pollCalls_ >= SIM_UART_POLL_CALLS))
+    {
+        uartPoll();
+    }
+    return rxHead_ != rxTail_;
+}
+
+u8 getByte(void)
+{
+    if (rxHead_ == rxTail_) return 0;
+    return rxBuf_[rxHead_++];
+}
+
+void resetReceiveFlag(void)
+{
+}
+
+void Serial_SendBufferedChar(u8 ch)
+{
+    fputc(ch, stderr);
+}
+
+/** Keil printf() has no 64 bit types and u32 is an int here, so l is
+  * dropped from the conversions before the format is passed on. */
+void CON_print(void *format, ...)
+{
+    char fmt[256];
+    const char *s = format;
+    unsigned i = 0;
+    int percent = 0;
+    va_list argptr;
+
+    if (simQuiet) return;
+    for ( ; *s && i < sizeof(fmt) - 1; s++)
+    {
+        if (*s == '%') percent = !percent;
+        else if (percent && *s == 'l') continue;
+        else if (percent && strchr("cdiuxXsp", *s)) percent = 0;
+        fmt[i++] = *s;
+    }
+    fmt[i] = '\0';
+    va_start(argptr, format);
+    vfprintf(stderr, fmt, argptr);
+    va_end(argptr);
+}
+
+void CON_hexdump(const u8 *buffer, u8 length)
+{
+    u8 i;
+
+    if (simQuiet) return;
+    for (i = 0; i < length; i++)
+    {
+        fprintf(stderr, "%02x%c", buffer[i], (i % 8 == 7 || i == length - 1) ? '\n' : ' ');
+    }
+}
@@ -0,0 +1,341 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Implementation of the macro engine which runs uploaded programs autonomously.
+  *
+  * See macro.h for a description of the program format.
+  * Frequency hopping and channel release are done using the functions
+  * provided by usb_commands.c, so a running program obeys the same
+  * listen before talk and maximum sending time rules as host commands.
+  */
+#include "c8051F340.h"
+#include "as399x_config.h"
+#include "as399x_public.h"
+#include "global.h"
+#include "gen2.h"
+#include "uart.h"
+#include "F3xx_Blink_Control.h"
+#include "F3xx_USB0_ReportHandler.h"
+#include "F3xx_USB0_InterruptServiceRoutine.h"
+#include "usb_commands.h"
+#include "macro.h"
+
+#define MACRODEBUG 0
+
+/** Program memory */
+static XDATA u8 macroProgram_[MACRO_PROGRAM_SIZE];
+/** Data collected by MACRO_OP_READ for the current tag */
+static XDATA u8 macroResult_[MACRO_RESULT_SIZE];
+/** Singulated copy of the current tag, holds the handle */
+static XDATA Tag macroTag_;
+
+static u8 macroResultLen;
+static u8 macroRunning = 0;
+static u8 macroCycles;
+static unsigned macroNumTags;
+
+/*------------------------------------------------------------------------- */
+/** Returns the length of the instruction at ins including the opcode,
+  * 0 for unknown opcodes. Computed in u16 as the length of WRITE is only
+  * bounded by macroValidate(). */
+static u16 macroInstrLength(const u8 *ins)
+{
+    switch (ins[0])
+    {
+        case MACRO_OP_END:
+        case MACRO_OP_FOREACH:
+        case MACRO_OP_SELECT:
+        case MACRO_OP_REPORT:
+        case MACRO_OP_NEXT:
+            return 1;
+        case MACRO_OP_INVENTORY:
+            return 2;
+        case MACRO_OP_FILTER:
+            return 3 + ins[2];
+        case MACRO_OP_ACCESS:
+            return 5;
+        case MACRO_OP_READ:
+        case MACRO_OP_LOCK:
+            return 4;
+        case MACRO_OP_WRITE:
+            return 4 + 2 * (u16)ins[3];
+        default:
+            return 0;
+    }
+}
+
+/*------------------------------------------------------------------------- */
+/** Checks the program for unknown opcodes, out of range operands and
+  * proper FOREACH/NEXT nesting. */
+static u8 macroValidate(void)
+{
+    u16 pc = 0;
+    u16 len;
+    u8 inLoop = 0;
+    u16 readBytes = 0;
+    const u8 *ins;
+
+    while (pc < MACRO_PROGRAM_SIZE)
+    {
+        ins = macroProgram_ + pc;
+        len = macroInstrLength(ins);
+        if (len == 0 || len > MACRO_PROGRAM_SIZE - pc) return MACRO_ERR_PROGRAM;
+        switch (ins[0])
+        {
+            case MACRO_OP_END:
+                return inLoop ? MACRO_ERR_PROGRAM : 0;
+            case MACRO_OP_INVENTORY:
+                if (inLoop || ins[1] > 15) return MACRO_ERR_PROGRAM;
+                break;
+            case MACRO_OP_FILTER:
+                if (inLoop || ins[1] + ins[2] > EPCLENGTH) return MACRO_ERR_PROGRAM;
+                break;
+            case MACRO_OP_FOREACH:
+                if (inLoop) return MACRO_ERR_PROGRAM;
+                inLoop = 1;
+                readBytes = 0;
+                break;
+            case MACRO_OP_NEXT:
+                if (!inLoop) return MACRO_ERR_PROGRAM;
+                inLoop = 0;
+                break;
+            case MACRO_OP_READ:
+                if (ins[3] == 0) return MACRO_ERR_PROGRAM;
+                readBytes += 2 * (u16)ins[3];
+                if (readBytes > MACRO_RESULT_SIZE) return MACRO_ERR_PROGRAM;
+                if (!inLoop) return MACRO_ERR_PROGRAM;
+                break;
+            case MACRO_OP_WRITE:
+                /* writeMEM() addresses the words with an u8 */
+                if (ins[3] == 0 || (u16)ins[2] + ins[3] > 0x100) return MACRO_ERR_PROGRAM;
+                /* fall through */
+            default:
+                if (!inLoop) return MACRO_ERR_PROGRAM;
+                break;
+        }
+        pc += len;
+    }
+    return MACRO_ERR_PROGRAM; /* no END found */
+}
+
+/*------------------------------------------------------------------------- */
+/** Returns the program counter after the NEXT instruction belonging to the
+  * FOREACH block pc is in. */
+static u8 macroSkipBlock(u8 pc)
+{
+    while (macroProgram_[pc] != MACRO_OP_NEXT)
+    {
+        pc += macroInstrLength(macroProgram_ + pc);
+    }
+    return pc + 1;
+}
+
+/*------------------------------------------------------------------------- */
+/** Removes all tags from tags_ whose epc does not match pattern at offset */
+static void macroFilter(u8 offset, u8 len, const u8 *pattern)
+{
+    unsigned i, kept = 0;
+    u8 j;
+
+    for (i = 0; i < macroNumTags; i++)
+    {
+        if (tags_[i].epclen < offset + len) continue;
+        for (j = 0; j < len; j++)
+        {
+            if (tags_[i].epc[offset + j] != pattern[j]) break;
+        }
+        if (j < len) continue;
+        if (kept != i) tags_[kept] = tags_[i];
+        kept++;
+    }
+    macroNumTags = kept;
+}
+
+/*------------------------------------------------------------------------- */
+/** Sends epc and collected data of tag to the host.
+  The device sends back:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>     2</th><th>     3</th><th>      4</th><th>5 .. 5+epclen</th><th>...</th></tr>
+    <tr><th>Content</th><td>0x62(ID)</td><td>length</td><td>status</td><td>epclen</td><td>datalen</td><td>epc</td><td>data</td></tr>
+  </table>
+ */
+static void macroReport(Tag *tag, u8 status)
+{
+    IN_PACKET[0] = IN_MACRO_ID;
+    IN_PACKET[1] = 5 + tag->epclen + macroResultLen;
+    IN_PACKET[2] = status;
+    IN_PACKET[3] = tag->epclen;
+    IN_PACKET[4] = macroResultLen;
+    copyBuffer(tag->epc, &IN_PACKET[5], tag->epclen);
+    copyBuffer(macroResult_, &IN_PACKET[5 + tag->epclen], macroResultLen);
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_MACRO_IDSize+1;
+    SendPacket(IN_MACRO_ID);
+}
+
+/*------------------------------------------------------------------------- */
+/** Executes one instruction of the FOREACH block on the current tag.
+  * @return the gen2 status code of the operation */
+static u8 macroTagOperation(const u8 *ins, Tag *tag, u8 *selected)
+{
+    u8 status = GEN2_OK;
+    u8 len;
+
+    if (ins[0] == MACRO_OP_REPORT)
+    {
+        macroReport(tag, GEN2_OK);
+        return GEN2_OK;
+    }
+    if (!continueCheckTimeout()) return GEN2_ERR_CHANNEL_TIMEOUT;
+    if (ins[0] == MACRO_OP_SELECT)
+    {
+        *selected = (gen2SearchForTags(&macroTag_, 1, tag->epc, tag->epclen, 0, continueCheckTimeout, 1) != 0);
+        return *selected ? GEN2_OK : GEN2_ERR_SELECT;
+    }
+    if (!*selected) return MACRO_ERR_NOT_SELECTED;
+
+    switch (ins[0])
+    {
+        case MACRO_OP_ACCESS:
+            status = gen2AccessTag(&macroTag_, (u8*)ins + 1);
+            break;
+        case MACRO_OP_READ:
+            if (macroResultLen + 2 * ins[3] > MACRO_RESULT_SIZE) return MACRO_ERR_OVERFLOW;
+            status = gen2ReadFromTag(&macroTag_, ins[1], ins[2], ins[3], macroResult_ + macroResultLen);
+            if (!status) macroResultLen += 2 * ins[3];
+            break;
+        case MACRO_OP_WRITE:
+            len = writeMEM(ins[2], &macroTag_, (u8*)ins + 4, ins[3], ins[1], &status);
+            if (len != ins[3] && status == GEN2_OK) status = 0xff;
+            break;
+        case MACRO_OP_LOCK:
+            status = gen2LockTag(&macroTag_, (u8*)ins + 1);
+            break;
+    }
+    return status;
+}
+
+/*------------------------------------------------------------------------- */
+u8 macroLoad(u8 offset, const u8 *prog, u8 len)
+{
+    macroStop();
+    if ((u16)offset + len > MACRO_PROGRAM_SIZE) return MACRO_ERR_PROGRAM;
+    copyBuffer((u8*)prog, macroProgram_ + offset, len);
+    return 0;
+}
+
+/*------------------------------------------------------------------------- */
+u8 macroStart(u8 cycles)
+{
+    u8 status = macroValidate();
+
+    if (status) return status;
+    macroCycles = cycles;
+    macroRunning = 1;
+    return 0;
+}
+
+/*------------------------------------------------------------------------- */
+void macroStop(void)
+{
+    macroRunning = 0;
+}
+
+/*------------------------------------------------------------------------- */
+bool macroIsRunning(void)
+{
+    return macroRunning;
+}
+
+/*------------------------------------------------------------------------- */
+void macroRun(void)
+{
+    u8 pc = 0, loopStart = 0;
+    u8 status = GEN2_OK, selected = 0;
+    unsigned tagIdx = 0;
+    bool channel = 0;
+    u8 *ins;
+
+    macroNumTags = 0;
+    while (macroProgram_[pc] != MACRO_OP_END)
+    {
+        ins = macroProgram_ + pc;
+        switch (ins[0])
+        {
+            case MACRO_OP_INVENTORY:
+                checkAndSetSession(SESSION_GEN2);
+                if (channel) hopChannelRelease();
+                channel = 1;
+                macroNumTags = 0;
+                if (!hopFrequencies())
+                {
+                    macroNumTags = gen2SearchForTagsFast(tags_, MAXTAG, 0, 0, ins[1], continueCheckTimeout, 1);
+                }
+#if MACRODEBUG
+                CON_print("macro: %hx tags\n", macroNumTags);
+#endif
+                break;
+            case MACRO_OP_FILTER:
+                macroFilter(ins[1], ins[2], ins + 3);
+                break;
+            case MACRO_OP_FOREACH:
+                if (macroNumTags == 0)
+                {
+                    pc = macroSkipBlock(pc);
+                    continue;
+                }
+                tagIdx = 0;
+                loopStart = pc + 1;
+                macroResultLen = 0;
+                selected = 0;
+                break;
+            case MACRO_OP_NEXT:
+                if (++tagIdx < macroNumTags)
+                {
+                    pc = loopStart;
+                    macroResultLen = 0;
+                    selected = 0;
+                    continue;
+                }
+                break;
+            default:
+                status = macroTagOperation(ins, tags_ + tagIdx, &selected);
+                if (status != GEN2_OK)
+                {
+#if MACRODEBUG
+                    CON_print("macro: op %hhx failed %hhx\n", ins[0], status);
+#endif
+                    macroReport(tags_ + tagIdx, status);
+                    pc = macroSkipBlock(pc) - 1; /* continue at NEXT */
+                    continue;
+                }
+                break;
+        }
+        pc += macroInstrLength(ins);
+    }
+
+    if (macroCycles && --macroCycles == 0)
+    {
+        macroRunning = 0;
+    }
+    if (channel) hopChannelRelease();
+}
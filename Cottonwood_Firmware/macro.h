@@ -0,0 +1,110 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief This file is the include file for the macro.c file.
+  *
+  * The macro engine executes small programs which are uploaded once by the
+  * host and afterwards run autonomously from the main loop, just like the
+  * cyclic inventory started by callStartStop(). A program chains the gen2
+  * primitives (inventory, filter, select, access, read, write, lock) and
+  * only the final results are reported back to the host.
+  *
+  * A program is a sequence of instructions. Each instruction starts with an
+  * opcode byte followed by a fixed number of operand bytes (except
+  * MACRO_OP_FILTER and MACRO_OP_WRITE whose length depends on an operand):
+  * <table>
+  *   <tr><th>Opcode</th><th>Operands</th><th>Description</th></tr>
+  *   <tr><td>0x00 END</td><td>-</td><td>end of one program cycle, RF channel is released</td></tr>
+  *   <tr><td>0x01 INVENTORY</td><td>q</td><td>hop and perform one inventory round with 2^q slots</td></tr>
+  *   <tr><td>0x02 FILTER</td><td>offset, len, pattern[len]</td><td>drop all tags whose epc at byte offset does not match pattern</td></tr>
+  *   <tr><td>0x03 FOREACH</td><td>-</td><td>start of the block executed for every remaining tag</td></tr>
+  *   <tr><td>0x04 SELECT</td><td>-</td><td>singulate the current tag, needed before ACCESS/READ/WRITE/LOCK</td></tr>
+  *   <tr><td>0x05 ACCESS</td><td>password[4]</td><td>access the current tag</td></tr>
+  *   <tr><td>0x06 READ</td><td>mem_type, address, word_count</td><td>read words and append them to the result data</td></tr>
+  *   <tr><td>0x07 WRITE</td><td>mem_type, address, word_count, data[2*word_count]</td><td>write words</td></tr>
+  *   <tr><td>0x08 LOCK</td><td>mask_action[3]</td><td>lock as in gen2LockTag()</td></tr>
+  *   <tr><td>0x09 REPORT</td><td>-</td><td>send the epc and result data of the current tag to the host</td></tr>
+  *   <tr><td>0x0A NEXT</td><td>-</td><td>end of the FOREACH block</td></tr>
+  * </table>
+  * If an instruction inside the FOREACH block fails, a report with the error
+  * code is sent and execution continues with the next tag.
+  */
+
+#ifndef __MACRO_H__
+#define __MACRO_H__
+
+#include "global.h"
+
+/** Size of the program memory in bytes */
+#define MACRO_PROGRAM_SIZE      128
+/** Maximum number of data bytes collected by READ instructions for one tag */
+#define MACRO_RESULT_SIZE       24
+
+#define MACRO_OP_END            0x00
+#define MACRO_OP_INVENTORY      0x01
+#define MACRO_OP_FILTER         0x02
+#define MACRO_OP_FOREACH        0x03
+#define MACRO_OP_SELECT         0x04
+#define MACRO_OP_ACCESS         0x05
+#define MACRO_OP_READ           0x06
+#define MACRO_OP_WRITE          0x07
+#define MACRO_OP_LOCK           0x08
+#define MACRO_OP_REPORT         0x09
+#define MACRO_OP_NEXT           0x0A
+
+/** Status reported if the program is malformed */
+#define MACRO_ERR_PROGRAM       0xF0
+/** Status reported if the result data of a tag exceeds MACRO_RESULT_SIZE */
+#define MACRO_ERR_OVERFLOW      0xF1
+/** Status reported if an instruction needs a selected tag but SELECT failed or was missing */
+#define MACRO_ERR_NOT_SELECTED  0xF2
+
+/*------------------------------------------------------------------------- */
+/** Copies len bytes of program code to offset of the program memory.
+  * Stops a running program.
+  * @return 0 on success, MACRO_ERR_PROGRAM if the code does not fit.
+  */
+u8 macroLoad(u8 offset, const u8 *prog, u8 len);
+
+/*------------------------------------------------------------------------- */
+/** Validates the loaded program and starts it.
+  * @param cycles number of program cycles to run, 0 runs until macroStop().
+  * @return 0 on success, MACRO_ERR_PROGRAM if the program is malformed.
+  */
+u8 macroStart(u8 cycles);
+
+/*------------------------------------------------------------------------- */
+/** Stops a running program. */
+void macroStop(void);
+
+/*------------------------------------------------------------------------- */
+/** @return 1 if a program is running. */
+bool macroIsRunning(void);
+
+/*------------------------------------------------------------------------- */
+/** Executes one cycle of the running program, i.e. from the first
+  * instruction until MACRO_OP_END. Should be called from the main loop
+  * while macroIsRunning() returns 1.
+  */
+void macroRun(void);
+
+#endif
@@ -37,13 +37,14 @@
 #include "iso6b.h"
 #include "tuner.h"
 #include "timer.h"
+#include "sched.h"
+#include "bench.h"
 #include "usb_commands.h"
 #include "F340_FlashPrimitives.h"
 #include "F3xx_USB0_Register.h"
 #include "F3xx_Blink_Control.h"
 #include "F3xx_USB0_InterruptServiceRoutine.h"
 #include "F3xx_USB0_Descriptor.h"
-#include <math.h>
 
 extern  Freq Frequencies;
 extern Tag tags_[MAXTAG];
@@ -51,28 +52,6 @@ extern Tag tags_[MAXTAG];
 extern TuningTable tuningTable;
 #endif
 
-static bool continueAlways( ) {return 1; }
-static void calcBestSlotSize( void )
-{
-    u8 round;
-    u8 powSlot;
-    u8 numTags;
-
-    for ( powSlot = 0; powSlot < 15 ; powSlot ++)
-    {
-        u8 maxTags=0;
-        u16 tagsFound=0;
-        for ( round = 0; round < 255 ; round ++)
-        {
-            numTags = gen2SearchForTags(tags_,16,0,0,powSlot,continueAlways,1);
-            tagsFound+= numTags;
-            if ( numTags > maxTags) maxTags = numTags;
-        }
-        CON_print("found with powSlot=%hhx %x tags, max %hhx\n",
-                                      powSlot,        tagsFound,maxTags);
-    }
-}
-
 static const u8 codes[0x10] = 
 {
     /* upper 3 bits length, lower 5 bits shorts/longs */
@@ -194,19 +173,20 @@ static u8 splitPowerCheck(void)
 
 /** main function
   * Initializes uController (System_Init()) and AS399x (as399xInitialize()). Afterwards
-  * it enters main loop in which the commands received via USB or UART are processed.
+  * it enters main loop in which the scheduler (see sched.h) processes the commands
+  * received via USB or UART.
   */
 int main(void)
 {
 
     u8 count = 0;
     u16 failure;
-    unsigned  short  counter = 200;
-    u8 a;
     PCA0MD &= ~0x40;                         /* WDTE = 0 (clear watchdog timer */
 
     /* System_Init already sets clocks, do this before initing uart */
     System_Init ();
+    timerInit();
+    benchInit();
 
     EA = 1; /* enable all interrupts */
 
@@ -247,7 +227,6 @@ int main(void)
     tunerInit();
 #endif
 
-    /*calcBestSlotSize();*/
 #ifdef ENTRY_POINT_ADDR
     /* systems seems to be up and running. set the magic byte to tell the bootloader
        to boot the image also next time */
@@ -258,6 +237,11 @@ int main(void)
 #endif
 
     initCommands(); /* USB report commands */
+    schedInit();
+    schedSetFailure(failure);
+#if ARNIE
+    timerSoftStart(TIMER_SOFT_POWERCHECK, MS_2_SLOWTICKS(500), MS_2_SLOWTICKS(500));
+#endif
 
 #if ! UARTSUPPORT
     Usb_Init ();
@@ -265,32 +249,13 @@ int main(void)
 
     while (1)
     {
-        if (counter)
-        {
-            counter--;
-        }
-        else
-        {
 #if ARNIE
-        failure = splitPowerCheck();
-#endif
-            counter = (24000<<(failure?4:0));
-            if (a) {
-                a=0;
-                LED1(0);
-            }
-            else {
-                a=1;
-                LED1(1);
-            }
+        if (timerSoftExpired(TIMER_SOFT_POWERCHECK))
+        {
+            failure = splitPowerCheck();
+            schedSetFailure(failure);
         }
-#ifdef POWER_DETECTOR
-        as399xCyclicPowerRegulation();  //check PA regulation
-#endif
-#if UARTSUPPORT
-        uartCommands();
-#else
-        commands(); /* main trigger for operation commands. */
 #endif
+        schedRun();
     }
 }
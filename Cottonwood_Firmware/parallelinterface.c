@@ -42,6 +42,7 @@
 #include "uart.h"
 #include "timer.h"
 #include "as399x_com.h"
+#include "trace.h"
 
 #define NOPDELAY(x)               { int i; for(i = 0; i < (x); i++) { NOP(); }}
 
@@ -128,6 +129,7 @@ void initInterface(void)
 /*------------------------------------------------------------------------- */
 void writeReadAS399x( const u8* wbuf, u8 wlen, u8* rbuf, u8 rlen, u8 stopMode, u8 doStart )
 {
+    TRACE_BUS_EVENT(doStart && wlen ? wbuf[0] : 0xff, wlen, rlen);
     if (wlen)
     {
         DPORTDIRWR();                         /*Changes Portdirection to Write */
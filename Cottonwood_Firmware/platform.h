@@ -38,11 +38,31 @@
 #include "as399x_config.h"
 
 /** Macro for enable external IRQ */
+#if HOSTSIM
+#define ENEXTIRQ()                {EX0 = 1; simExtIrq();}
+#else
 #define ENEXTIRQ()                {EX0 = 1;}
+#endif
 
 /** Macro for disable external IRQ */
 #define DISEXTIRQ()               EX0 = 0
 
+/** Macro for busy wait loops polling a variable set by an ISR, lets the
+  * simulated AS399x advance in the host build (see host/c8051F340.h) */
+#if HOSTSIM
+#define BUSYWAIT()                simBusyWait()
+#else
+#define BUSYWAIT()
+#endif
+
+/** Macro for wait loops on soft timers, which only change with the slow
+  * tick, lets the host build skip to the next slow tick */
+#if HOSTSIM
+#define SLOWTICKWAIT()            simSlowTickWait()
+#else
+#define SLOWTICKWAIT()
+#endif
+
 /** Macro setting data output port */
 #define SETOUTPORT(x)             DATAOUTPORT=(x)
 
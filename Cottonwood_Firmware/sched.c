@@ -0,0 +1,210 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Cooperative scheduler of the main loop based on protothreads.
+  *
+  * See sched.h for an overview. Threads are called directly and not via
+  * function pointers to keep the call tree visible to the linker's
+  * overlay analysis.
+  */
+#include "c8051F340.h"
+#include "as399x_config.h"
+#include "platform.h"
+#include "as399x_public.h"
+#include "global.h"
+#include "timer.h"
+#include "uart.h"
+#include "usb_commands.h"
+#include "pt.h"
+#include "sched.h"
+
+#define SCHEDDEBUG 0
+
+/** LED blink period in normal operation */
+#define SCHED_LED_PERIOD            MS_2_SLOWTICKS(500)
+/** LED blink period if initialization failed */
+#define SCHED_LED_PERIOD_FAILURE    MS_2_SLOWTICKS(8000)
+
+static struct pt ptCommand_;
+static struct pt ptLed_;
+#ifdef POWER_DETECTOR
+static struct pt ptRegulation_;
+#endif
+
+static u16 ledPeriod_;
+static u8 ledState_;
+
+/** Idle time in fine ticks */
+static u32 idleFineTicks_;
+/** Total time in slow ticks */
+static u32 totalSlowTicks_;
+static u16 lastSlowTicks_;
+
+/*------------------------------------------------------------------------- */
+static PT_THREAD(schedCommandThread(struct pt *pt))
+{
+    PT_BEGIN(pt);
+    while (1)
+    {
+        PT_WAIT_UNTIL(pt, commandsPending());
+#if UARTSUPPORT
+        uartCommands();
+#else
+        commands(); /* main trigger for operation commands. */
+#endif
+        PT_YIELD(pt);
+    }
+    PT_END(pt);
+}
+
+/*------------------------------------------------------------------------- */
+static PT_THREAD(schedLedThread(struct pt *pt))
+{
+    PT_BEGIN(pt);
+    while (1)
+    {
+        PT_WAIT_UNTIL(pt, timerSoftExpired(TIMER_SOFT_LED));
+        ledState_ = !ledState_;
+        LED1(ledState_);
+    }
+    PT_END(pt);
+}
+
+#ifdef POWER_DETECTOR
+/*------------------------------------------------------------------------- */
+static PT_THREAD(schedRegulationThread(struct pt *pt))
+{
+    PT_BEGIN(pt);
+    while (1)
+    {
+        as399xCyclicPowerRegulation();  //check PA regulation
+        PT_YIELD(pt);
+    }
+    PT_END(pt);
+}
+#endif
+
+/*------------------------------------------------------------------------- */
+void schedInit(void)
+{
+    PT_INIT(&ptCommand_);
+    PT_INIT(&ptLed_);
+#ifdef POWER_DETECTOR
+    PT_INIT(&ptRegulation_);
+#endif
+    ledPeriod_ = SCHED_LED_PERIOD;
+    timerSoftStart(TIMER_SOFT_LED, SCHED_LED_PERIOD, SCHED_LED_PERIOD);
+    idleFineTicks_ = 0;
+    totalSlowTicks_ = 0;
+    lastSlowTicks_ = timerSlowTicks();
+}
+
+/*------------------------------------------------------------------------- */
+void schedRun(void)
+{
+    u16 start = timerFineTicks();
+    u16 now;
+    bool busy = commandsPending();
+
+    schedCommandThread(&ptCommand_);
+#ifdef POWER_DETECTOR
+    schedRegulationThread(&ptRegulation_);
+#endif
+    schedLedThread(&ptLed_);
+
+    if (!busy)
+    {
+        if (!commandsPending())
+        { /* nothing to do, put CPU into idle mode until next interrupt,
+             at the latest the timer 0 overflow */
+            PCON |= 0x01;
+        }
+        idleFineTicks_ += (u16)(timerFineTicks() - start);
+    }
+    now = timerSlowTicks();
+    totalSlowTicks_ += (u16)(now - lastSlowTicks_);
+    lastSlowTicks_ = now;
+}
+
+/*------------------------------------------------------------------------- */
+void schedBackground(void)
+{
+    timerService();
+    schedLedThread(&ptLed_);
+}
+
+/*------------------------------------------------------------------------- */
+void schedWait_us(u16 us)
+{
+    u16 start = timerFineTicks();
+    u16 ticks = US_2_FINETICKS(us) + 1; /* we may have started just before a tick */
+    u16 passed;
+
+    do
+    {
+        schedBackground();
+        passed = timerFineTicks() - start;
+    } while (passed < ticks);
+    idleFineTicks_ += passed;
+}
+
+/*------------------------------------------------------------------------- */
+void schedWait_ms(u16 ms)
+{
+    timerSoftStart(TIMER_SOFT_WAIT, MS_2_SLOWTICKS(ms) + 1, 0); /* MS_2_SLOWTICKS() rounds down */
+    schedWaitTimer(TIMER_SOFT_WAIT);
+}
+
+/*------------------------------------------------------------------------- */
+void schedWaitTimer(u8 id)
+{
+    u16 start = timerSlowTicks();
+
+    while (!timerSoftExpired(id) && timerSoftRunning(id))
+    {
+        schedBackground();
+        SLOWTICKWAIT();
+    }
+    idleFineTicks_ += (u32)(u16)(timerSlowTicks() - start) << 8;
+}
+
+/*------------------------------------------------------------------------- */
+void schedSetFailure(u16 failure)
+{
+    u16 period = failure ? SCHED_LED_PERIOD_FAILURE : SCHED_LED_PERIOD;
+
+    if (period == ledPeriod_) return;
+    ledPeriod_ = period;
+    timerSoftStart(TIMER_SOFT_LED, period, period);
+}
+
+/*------------------------------------------------------------------------- */
+void schedGetLoad(u32 *idleMs, u32 *totalMs)
+{
+    *idleMs  = idleFineTicks_ * 2 / 375;  /* 16/3 us per fine tick */
+    *totalMs = totalSlowTicks_ * 65 / 48;
+#if SCHEDDEBUG
+    CON_print("idle %lx of %lx ms\n", *idleMs, *totalMs);
+#endif
+    idleFineTicks_ = 0;
+    totalSlowTicks_ = 0;
+}
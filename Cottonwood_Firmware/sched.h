@@ -0,0 +1,93 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief This file is the include file for the sched.c file.
+  *
+  * The main loop is organized as a set of cooperative protothreads (see pt.h):
+  * command processing, PA regulation and LED signalling. Long waits inside
+  * the protocol layers use schedWait_us() and schedWait_ms() instead of
+  * udelay() and mdelay(). These run the background threads, which do not
+  * access the AS399x, while waiting and account the wait as idle time.
+  */
+
+#ifndef __SCHED_H__
+#define __SCHED_H__
+
+#include "global.h"
+
+/*------------------------------------------------------------------------- */
+/** Initializes all threads and the idle time measurement. timerInit() has
+  * to be called before.
+  */
+void schedInit(void);
+
+/*------------------------------------------------------------------------- */
+/** Runs every thread once. Has to be called from the main loop. If no
+  * command is pending the CPU is put into idle mode until the next interrupt.
+  */
+void schedRun(void);
+
+/*------------------------------------------------------------------------- */
+/** Runs the threads which may be executed while a command is being processed,
+  * i.e. which do not access the AS399x or the command buffers. This is only
+  * the LED thread: PA regulation measures and adjusts the output power through
+  * the AS399x, which inside a wait would interleave with the operation waiting
+  * (e.g. for the PLL or the receiver to settle). Command reception fills
+  * getBuffer_, which holds the parameters of the command being processed.
+  * Both run from schedRun() between commands, the inventory loops call
+  * as399xCyclicPowerRegulation() between rounds and poll the receive flag for
+  * aborts themselves.
+  */
+void schedBackground(void);
+
+/*------------------------------------------------------------------------- */
+/** Waits at least us microseconds (resolution ~5.3us) and runs schedBackground()
+  * in the meantime. Should not be used for waits above 300ms, use schedWait_ms()
+  * instead.
+  */
+void schedWait_us(u16 us);
+
+/*------------------------------------------------------------------------- */
+/** Waits at least ms milliseconds (resolution ~1.4ms) and runs schedBackground()
+  * in the meantime. Uses software timer TIMER_SOFT_WAIT.
+  */
+void schedWait_ms(u16 ms);
+
+/*------------------------------------------------------------------------- */
+/** Waits until software timer id (see timerSoftStart()) expires and runs
+  * schedBackground() in the meantime. Returns immediately if the timer is
+  * not running. Periodic timers return on their next expiration.
+  */
+void schedWaitTimer(u8 id);
+
+/*------------------------------------------------------------------------- */
+/** Sets the failure state, if failure != 0 the LED blinks slowly. */
+void schedSetFailure(u16 failure);
+
+/*------------------------------------------------------------------------- */
+/** Returns the idle time and the total time in ms passed since the last call
+  * and restarts the measurement. Idle time is time spent in schedWait_us(),
+  * schedWait_ms() and in main loop passes without any pending command.
+  */
+void schedGetLoad(u32 *idleMs, u32 *totalMs);
+
+#endif
@@ -51,6 +51,7 @@
 #include "uart.h"
 #include "timer.h"
 #include "as399x_com.h"
+#include "trace.h"
 
 
 /*------------------------------------------------------------------------- */
@@ -155,6 +156,7 @@ void writeReadAS399x( const u8* wbuf, u8 wlen, u8* rbuf, u8 rlen, u8 stopMode, u
     u8 i;
     u8 d;
 
+    TRACE_BUS_EVENT(doStart && wlen ? wbuf[0] : 0xff, wlen, rlen);
     if ( doStart) IO4(0);
 
     for ( i = 0; i< wlen; i++ )
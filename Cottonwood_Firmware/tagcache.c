@@ -0,0 +1,219 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Implementation of the tag memory cache, see tagcache.h
+  */
+#include "c8051F340.h"
+#include "as399x_config.h"
+#include "global.h"
+#include "gen2.h"
+#include "timer.h"
+#include "tagcache.h"
+#include "string.h"
+
+#if TAGCACHE
+struct tagcacheEntry
+{
+    u8 epc[TAGCACHE_EPCLEN];
+    u8 epclen;          /* 0 if the entry is free */
+    u8 memBank;
+    u8 wordPtr;
+    u8 wordCount;
+    u16 time;           /* timerSlowTicks() when stored */
+    u8 words[2 * TAGCACHE_WORDS];
+};
+
+static XDATA struct tagcacheEntry tagcache_[TAGCACHE_ENTRIES];
+/** Time to live in slow ticks, 0 if disabled */
+static u16 tagcacheTtl_;
+static u16 tagcacheTtlMs_;
+static u16 tagcacheHits_;
+static u16 tagcacheMisses_;
+
+static bool tagcacheIsTag(const struct tagcacheEntry XDATA *e, const Tag *tag)
+{
+    return e->epclen == tag->epclen && !memcmp(e->epc, tag->epc, tag->epclen);
+}
+
+static bool tagcacheExpired(const struct tagcacheEntry XDATA *e)
+{
+    return e->memBank != MEM_TID && (u16)(timerSlowTicks() - e->time) > tagcacheTtl_;
+}
+
+void tagcacheSetTtl(u16 ms)
+{
+    u8 i;
+
+    if (ms > TAGCACHE_MAXTTL) ms = TAGCACHE_MAXTTL;
+    tagcacheTtlMs_ = ms;
+    tagcacheTtl_ = MS_2_SLOWTICKS(ms);
+    if (ms) return;
+    for (i = 0; i < TAGCACHE_ENTRIES; i++)
+    {
+        tagcache_[i].epclen = 0;
+    }
+}
+
+u16 tagcacheGetTtl(void)
+{
+    return tagcacheTtlMs_;
+}
+
+bool tagcacheRead(const Tag *tag, u8 memBank, u8 wordPtr, u8 wordCount, u8 *destbuf)
+{
+    struct tagcacheEntry XDATA *e;
+    u8 i;
+
+    if (!tagcacheTtlMs_) return 0;
+    for (i = 0; i < TAGCACHE_ENTRIES; i++)
+    {
+        e = &tagcache_[i];
+        if (!e->epclen || e->memBank != memBank || !tagcacheIsTag(e, tag)) continue;
+        if (wordPtr < e->wordPtr || (u16)wordPtr + wordCount > (u16)e->wordPtr + e->wordCount) continue;
+        if (tagcacheExpired(e))
+        {
+            e->epclen = 0;
+            continue;
+        }
+        copyBuffer(e->words + 2 * (wordPtr - e->wordPtr), destbuf, 2 * wordCount);
+        tagcacheHits_++;
+        return 1;
+    }
+    tagcacheMisses_++;
+    return 0;
+}
+
+void tagcacheStore(const Tag *tag, u8 memBank, u8 wordPtr, u8 wordCount, const u8 *srcbuf)
+{
+    struct tagcacheEntry XDATA *e;
+    struct tagcacheEntry XDATA *oldest = tagcache_;
+    u16 now = timerSlowTicks();
+    u8 i;
+
+    if (!tagcacheTtlMs_ || tag->epclen > TAGCACHE_EPCLEN || wordCount == 0 || wordCount > TAGCACHE_WORDS) return;
+    for (i = 0; i < TAGCACHE_ENTRIES; i++)
+    {
+        e = &tagcache_[i];
+        if (e->epclen && e->memBank == memBank && e->wordPtr == wordPtr && tagcacheIsTag(e, tag))
+        {   /* refresh the entry of the same words */
+            oldest = e;
+            break;
+        }
+        if (!e->epclen)
+        {   /* a free entry is taken before any used one */
+            oldest = e;
+        }
+        else if (oldest->epclen && (u16)(now - e->time) > (u16)(now - oldest->time))
+        {
+            oldest = e;
+        }
+    }
+    e = oldest;
+    copyBuffer((u8*)tag->epc, e->epc, tag->epclen);
+    e->epclen = tag->epclen;
+    e->memBank = memBank;
+    e->wordPtr = wordPtr;
+    e->wordCount = wordCount;
+    e->time = timerSlowTicks();
+    copyBuffer((u8*)srcbuf, e->words, 2 * wordCount);
+}
+
+void tagcacheInvalidate(const Tag *tag)
+{
+    u8 i;
+
+    for (i = 0; i < TAGCACHE_ENTRIES; i++)
+    {
+        if (tagcache_[i].epclen && tagcacheIsTag(&tagcache_[i], tag)) tagcache_[i].epclen = 0;
+    }
+}
+
+void tagcacheService(void)
+{
+    u8 i;
+
+    for (i = 0; i < TAGCACHE_ENTRIES; i++)
+    {
+        if (tagcache_[i].epclen && tagcacheExpired(&tagcache_[i])) tagcache_[i].epclen = 0;
+    }
+}
+
+void tagcacheGetStats(u16 *hits, u16 *misses, u8 *used)
+{
+    u8 i;
+
+    *hits = tagcacheHits_;
+    *misses = tagcacheMisses_;
+    *used = 0;
+    for (i = 0; i < TAGCACHE_ENTRIES; i++)
+    {
+        if (tagcache_[i].epclen) (*used)++;
+    }
+    tagcacheHits_ = 0;
+    tagcacheMisses_ = 0;
+}
+#else
+void tagcacheSetTtl(u16 ms)
+{
+    (void)ms;
+}
+
+u16 tagcacheGetTtl(void)
+{
+    return 0;
+}
+
+bool tagcacheRead(const Tag *tag, u8 memBank, u8 wordPtr, u8 wordCount, u8 *destbuf)
+{
+    (void)tag;
+    (void)memBank;
+    (void)wordPtr;
+    (void)wordCount;
+    (void)destbuf;
+    return 0;
+}
+
+void tagcacheStore(const Tag *tag, u8 memBank, u8 wordPtr, u8 wordCount, const u8 *srcbuf)
+{
+    (void)tag;
+    (void)memBank;
+    (void)wordPtr;
+    (void)wordCount;
+    (void)srcbuf;
+}
+
+void tagcacheInvalidate(const Tag *tag)
+{
+    (void)tag;
+}
+
+void tagcacheService(void)
+{
+}
+
+void tagcacheGetStats(u16 *hits, u16 *misses, u8 *used)
+{
+    *hits = 0;
+    *misses = 0;
+    *used = 0;
+}
+#endif
@@ -0,0 +1,78 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief This file is the include file for the tagcache.c file.
+  *
+  * The tag memory cache keeps the data of recent Reads, keyed by the EPC of
+  * the tag plus memory bank, word pointer and word count, so that repeated
+  * reads of the same words (see readDataFromTag()) are answered without
+  * singulating the tag again. A Read is served if a valid entry of the same
+  * tag and bank covers all requested words.
+  * Entries of the TID bank never expire, the others after the time to live
+  * set with tagcacheSetTtl(). Writes through writeMEM() drop all entries of
+  * the tag. If the cache is full the oldest entry is replaced.
+  */
+
+#ifndef __TAGCACHE_H__
+#define __TAGCACHE_H__
+
+#include "as399x_config.h"
+#include "global.h"
+#include "as399x_public.h"
+
+/** Number of entries, each takes 18 + 2 * TAGCACHE_WORDS bytes of XDATA */
+#define TAGCACHE_ENTRIES        6
+/** Most words per entry */
+#define TAGCACHE_WORDS          8
+/** Most EPC bytes, tags with longer EPCs are not cached */
+#define TAGCACHE_EPCLEN         12
+/** Largest time to live in ms, entries have to expire before the slow tick
+  * clock wraps (see timerSlowTicks()) */
+#define TAGCACHE_MAXTTL         60000
+
+/** Sets the time to live of entries not in the TID bank in ms, at most
+  * TAGCACHE_MAXTTL. 0 disables the cache and drops all entries. */
+void tagcacheSetTtl(u16 ms);
+
+/** @return the time to live in ms, 0 if the cache is disabled */
+u16 tagcacheGetTtl(void);
+
+/** Copies wordCount words at wordPtr of memBank of tag to destbuf if they
+  * are cached and valid, counts a hit or a miss.
+  * @return 1 if the words were copied, 0 if they have to be read from the tag */
+bool tagcacheRead(const Tag *tag, u8 memBank, u8 wordPtr, u8 wordCount, u8 *destbuf);
+
+/** Stores wordCount words read from wordPtr of memBank of tag. */
+void tagcacheStore(const Tag *tag, u8 memBank, u8 wordPtr, u8 wordCount, const u8 *srcbuf);
+
+/** Drops all entries of tag, e.g. before writing to it. */
+void tagcacheInvalidate(const Tag *tag);
+
+/** Drops expired entries. Has to be called regularly, at least every
+  * 25 seconds, so that no entry survives the wrap of the clock. */
+void tagcacheService(void);
+
+/** Returns the number of hits and misses since the last call and the number
+  * of entries used. */
+void tagcacheGetStats(u16 *hits, u16 *misses, u8 *used);
+
+#endif
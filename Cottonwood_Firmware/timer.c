@@ -72,7 +72,28 @@ void udelay( u16 us )
     while(!TIMER_IS_DONE());
 }
 
-void timerStartMeasure( )
+/** Value of the slow tick clock at the last call of timerStartMeasure() */
+static u16 measureStart_;
+
+/** Software timer, deadline and period are in slow ticks */
+struct timerSoft
+{
+    u16 deadline;
+    u16 remaining;  /**< ticks still to go after deadline, see timerSoftArm() */
+    u16 period;     /**< 0 for one-shot timers */
+    u8 running;
+    u8 expired;
+};
+
+/** Longest step of a software timer. timerService() compares the deadline
+  signed, longer times are split into steps so that it cannot wrap. */
+#define TIMER_SOFT_STEP         0x4000
+
+static XDATA struct timerSoft timerSoft_[TIMER_SOFT_NUM];
+/** Slow tick at which timerService() did the last check */
+static u16 serviceTick_;
+
+void timerInit( )
 {
     CKCON     |= 0x04;     /* SYSCLK for Timer 0*/
     TCON      &= ~0x10;    /* Stop timer 0 */
@@ -88,9 +109,17 @@ void timerStartMeasure( )
     PCA0H      = 0;
 
     TCON      |= 0x10;     /* Start timer 0 */
+    ET0        = 1;        /* Overflow interrupt wakes CPU from idle mode */
+    measureStart_ = 0;
+}
 
+/** Timer 0 overflow interrupt, only used to leave idle mode (see schedRun()).
+  * The overflow flag is cleared by hardware. */
+void timer0Interrupt(void) interrupt 1
+{
 }
-u16 timerMeasure_slowTicks( )
+
+u16 timerSlowTicks( )
 {
     u16 vall,valh;
     do
@@ -100,3 +129,116 @@ u16 timerMeasure_slowTicks( )
     } while ( valh != PCA0H);
     return (valh<<8)|vall;
 }
+
+u16 timerFineTicks( )
+{
+    u8 vall,valh;
+    do
+    {
+        valh = PCA0L;
+        vall = TH0;
+    } while ( valh != PCA0L);
+    return ((u16)valh<<8)|vall;
+}
+
+void timerStartMeasure( )
+{
+    measureStart_ = timerSlowTicks();
+}
+
+u16 timerMeasure_slowTicks( )
+{
+    return timerSlowTicks() - measureStart_;
+}
+
+void timerStopwatchStart( struct timerStopwatch *sw )
+{
+    sw->slow = timerSlowTicks();
+    sw->fine = timerFineTicks();
+}
+
+u32 timerStopwatch_us( struct timerStopwatch *sw )
+{
+    u16 slow = timerSlowTicks() - sw->slow;
+
+    if (slow < 200) /* fine clock wraps after 256 slow ticks */
+        return FINETICKS_2_US((u16)(timerFineTicks() - sw->fine));
+    return ((u32)slow << 16) / (CLK / 1000000UL);
+}
+
+/** Sets the deadline of t to ticks slow ticks after from */
+static void timerSoftArm( struct timerSoft XDATA *t, u16 from, u16 ticks )
+{
+    t->remaining = 0;
+    if (ticks > TIMER_SOFT_STEP)
+    {
+        t->remaining = ticks - TIMER_SOFT_STEP;
+        ticks = TIMER_SOFT_STEP;
+    }
+    t->deadline = from + ticks;
+}
+
+void timerSoftStart( u8 id, u16 ticks, u16 period )
+{
+    struct timerSoft XDATA *t = &timerSoft_[id];
+    u16 now = timerSlowTicks();
+
+    t->running = 0;
+    timerSoftArm(t, now, ticks);
+    t->period = period;
+    t->expired = 0;
+    t->running = 1;
+    serviceTick_ = now - 1; /* force a check on the next timerService() */
+}
+
+void timerSoftStop( u8 id )
+{
+    timerSoft_[id].running = 0;
+    timerSoft_[id].expired = 0;
+}
+
+bool timerSoftExpired( u8 id )
+{
+    timerService();
+    if (!timerSoft_[id].expired) return 0;
+    timerSoft_[id].expired = 0;
+    return 1;
+}
+
+bool timerSoftRunning( u8 id )
+{
+    return timerSoft_[id].running;
+}
+
+void timerService( )
+{
+    u8 i;
+    u16 now = timerSlowTicks();
+    struct timerSoft XDATA *t;
+
+    if (now == serviceTick_) return; /* nothing can have expired since last check */
+    serviceTick_ = now;
+    for (i = 0; i < TIMER_SOFT_NUM; i++)
+    {
+        t = &timerSoft_[i];
+        if (!t->running || (s16)(now - t->deadline) < 0) continue;
+        if (t->remaining)
+        { /* only a step of a long time passed */
+            timerSoftArm(t, t->deadline, t->remaining);
+            continue;
+        }
+        t->expired = 1;
+        if (t->period)
+        {
+            timerSoftArm(t, t->deadline, t->period);
+            if ((s16)(now - t->deadline) >= 0)
+            { /* we missed several periods, do not try to catch up */
+                timerSoftArm(t, now, t->period);
+            }
+        }
+        else
+        {
+            t->running = 0;
+        }
+    }
+}
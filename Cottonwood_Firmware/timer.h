@@ -37,12 +37,24 @@
 #if (CLK == 48000000)
 #define SLOWTICKS_2_MS( TICKS ) (((TICKS)>1000)?((((TICKS)+24)/48)*65):(((TICKS)*65)/48)) 
 #define MS_2_SLOWTICKS( MS    ) (((MS   )>1000)?((((MS   )+32)>>6)*48):(((MS   )*48)>>6))
+/* one fine tick are 256 SYSCLK cycles = 16/3 us, rounded up */
+#define US_2_FINETICKS( US    ) ((u16)((((u32)(US))*3+15)>>4))
+#define FINETICKS_2_US( TICKS ) ((u32)(TICKS)*16/3)
 #elif (CLK == 24000000)
 #elif (CLK == 12000000)
 #else 
 #error CLK not supported
 #endif
 
+/** Number of software timers, see timerSoftStart() */
+#define TIMER_SOFT_NUM          5
+/** Software timer ids */
+#define TIMER_SOFT_WAIT         0   /**< used by schedWait_ms() */
+#define TIMER_SOFT_LED          1   /**< LED blinking */
+#define TIMER_SOFT_POWERCHECK   2   /**< split power supply check on ARNIE */
+#define TIMER_SOFT_DUTY         3   /**< off phase of duty cycled cyclic inventory */
+#define TIMER_SOFT_POWERDOWN    4   /**< idle time before the AS399x is powered down */
+
 void timerStart_ms( u16 ms );
 
 /*!
@@ -68,8 +80,29 @@ void timerStart_us( u16 us );
 */
 void udelay( u16 us );
 
+/*!
+  Start the free running clock using timer0 and PCA. Timer0 counts SYSCLK
+  cycles, the PCA counts timer0 overflows (slow ticks). Has to be called
+  once at startup, timer0 and PCA must not be used otherwise.
+  The timer0 interrupt is enabled to wake up the CPU from idle mode at
+  least once per slow tick.
+  */
+void timerInit( );
+
+/*!
+  Value of the free running slow tick clock. Wraps after 65536 slow ticks (~89s).
+  */
+u16 timerSlowTicks( );
+
+/*!
+  Value of the free running fine clock, one tick are 256 SYSCLK cycles.
+  Wraps after 65536 fine ticks (~349ms at 48MHz). Use US_2_FINETICKS() to convert.
+  */
+u16 timerFineTicks( );
+
 /*! 
-  Start measurement using timer0 and PCA
+  Start measurement. Only takes a snapshot of the free running clock
+  started by timerInit().
   */
 void timerStartMeasure( );
 
@@ -78,4 +111,59 @@ void timerStartMeasure( );
   Value returned is in slow ticks. Use SLOWTICKS_2_MS() and MS_2_SLOWTICKS() to convert.
   */
 u16 timerMeasure_slowTicks( );
+/** Stopwatch based on the free running clocks, see timerStopwatchStart() */
+struct timerStopwatch
+{
+    u16 slow;
+    u16 fine;
+};
+
+/*!
+  Start stopwatch sw. Use timerStopwatch_us() to read the time passed.
+*/
+void timerStopwatchStart( struct timerStopwatch *sw );
+
+/*!
+  Returns the time passed since timerStopwatchStart() in us. Resolution is
+  ~5.3us for times up to ~270ms, ~1.4ms above. Range is ~89s.
+*/
+u32 timerStopwatch_us( struct timerStopwatch *sw );
+
+/*!
+  Start software timer id. The timer expires ticks slow ticks from now and,
+  if period is not 0, afterwards every period slow ticks. All software
+  timers are driven by the slow tick clock, expiration is detected by
+  timerService(). Use timerSoftExpired() to poll for expiration.
+
+  Both ticks and period may use the full u16 range, i.e. up to ~89s.
+  MS_2_SLOWTICKS() takes up to 65503ms, above that its 16 bit arithmetic
+  wraps.
+
+  \param id : one of TIMER_SOFT_WAIT, TIMER_SOFT_LED, ...
+  \param ticks : slow ticks until first expiration, use MS_2_SLOWTICKS() to convert.
+  \param period : slow ticks between subsequent expirations, 0 for one-shot timers.
+*/
+void timerSoftStart( u8 id, u16 ticks, u16 period );
+
+/*!
+  Stop software timer id and clear a pending expiration.
+*/
+void timerSoftStop( u8 id );
+
+/*!
+  Returns 1 once for every expiration of software timer id.
+*/
+bool timerSoftExpired( u8 id );
+
+/*!
+  Returns 1 if software timer id is running, i.e. one-shot timers which
+  did not yet expire and all periodic timers.
+*/
+bool timerSoftRunning( u8 id );
+
+/*!
+  Check all software timers for expiration. Cheap if the slow tick clock did
+  not advance since the last call, may thus be called from any polling loop.
+*/
+void timerService( );
 #endif
@@ -0,0 +1,112 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Implementation of the hot path trace buffer, see trace.h
+  */
+#include "c8051F340.h"
+#include "as399x_config.h"
+#include "global.h"
+#include "timer.h"
+#include "trace.h"
+
+#if TRACE
+struct traceEntry
+{
+    u8 id;
+    u8 arg;
+    u16 time;
+};
+
+static XDATA struct traceEntry traceBuf_[TRACE_SIZE];
+/** Index of the next entry to write */
+static u8 traceHead_;
+static u8 traceCount_;
+static u8 traceMode_ = TRACE_MODE_RING;
+
+void traceRecord(u8 id, u8 arg)
+{
+    struct traceEntry XDATA *e = &traceBuf_[traceHead_];
+
+    if (traceMode_ == TRACE_MODE_OFF) return;
+    if (traceMode_ == TRACE_MODE_ONESHOT && traceCount_ == TRACE_SIZE) return;
+
+    e->time = timerFineTicks();
+    e->id = id;
+    e->arg = arg;
+    traceHead_ = (traceHead_ + 1) & (TRACE_SIZE - 1);
+    if (traceCount_ < TRACE_SIZE) traceCount_++;
+}
+
+u8 traceCount(void)
+{
+    return traceCount_;
+}
+
+void traceGet(u8 index, u8 *dest)
+{
+    struct traceEntry XDATA *e = &traceBuf_[(traceHead_ - traceCount_ + index) & (TRACE_SIZE - 1)];
+
+    dest[0] = e->id;
+    dest[1] = e->arg;
+    u16ToBuffer(e->time, dest + 2);
+}
+
+void traceClear(void)
+{
+    traceCount_ = 0;
+}
+
+void traceSetMode(u8 mode)
+{
+    traceMode_ = mode;
+}
+
+u8 traceGetMode(void)
+{
+    return traceMode_;
+}
+#else
+u8 traceCount(void)
+{
+    return 0;
+}
+
+void traceGet(u8 index, u8 *dest)
+{
+    (void)index;
+    (void)dest;
+}
+
+void traceClear(void)
+{
+}
+
+void traceSetMode(u8 mode)
+{
+    (void)mode;
+}
+
+u8 traceGetMode(void)
+{
+    return TRACE_MODE_OFF;
+}
+#endif
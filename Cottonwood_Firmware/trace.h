@@ -0,0 +1,108 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief This file is the include file for the trace.c file.
+  *
+  * If #TRACE is set in as399x_config.h events on the hot paths (gen2 inventory,
+  * frequency hopping, report sending) are recorded together with the fine
+  * clock (see timerFineTicks(), 16/3 us per tick) into a ring buffer in XDATA.
+  * The buffer is read out with callTraceDump() and can be converted with
+  * trace2perfetto.pl into the Chrome trace format, e.g. for ui.perfetto.dev.
+  * Recording one event takes about 1us, so timing critical paths are
+  * hardly influenced. If #TRACE is 0 TRACE_EVENT() generates no code.
+  *
+  * If additionally #BUSREC is set, every writeReadAS399x() call is recorded
+  * as bus event: id is TRACE_BUS | TRACE_BUS_READ (if bytes were read) |
+  * number of bytes transferred (at most TRACE_BUS_LEN), arg is the first
+  * byte written, i.e. the address or direct command, 0xff for continued
+  * transfers. Reads from extInt() are not recorded. busreplay.pl counts
+  * transactions and bytes per slot, tag, read and hop from a dump.
+  */
+
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include "as399x_config.h"
+#include "global.h"
+
+/** Number of entries in the ring buffer, has to be a power of 2 */
+#if BUSREC
+#define TRACE_SIZE              128
+#else
+#define TRACE_SIZE              64
+#endif
+/** Number of bytes per entry in traceGet(): id, arg, time (LSB first) */
+#define TRACE_ENTRY_SIZE        4
+
+/* Event ids, arg is given in brackets */
+#define TRACE_QUERY             0x01    /**< Query sent (q) */
+#define TRACE_SLOT              0x02    /**< next slot started (remaining slots) */
+#define TRACE_RN16              0x03    /**< RN16 received, before ACK */
+#define TRACE_ACK               0x04    /**< ACK sent */
+#define TRACE_EPC               0x05    /**< EPC received and next command sent (1 if EPC is valid) */
+#define TRACE_REQRN             0x06    /**< ReqRN sent */
+#define TRACE_HOP               0x07    /**< channel allocated, antenna on (frequency index) */
+#define TRACE_LBT_BEGIN         0x08    /**< listen before talk started */
+#define TRACE_LBT_END           0x09    /**< listen before talk finished (frequency index) */
+#define TRACE_USB_SEND          0x0A    /**< report sent to host (report id) */
+#define TRACE_READ              0x0B    /**< gen2ReadFromTag() started (word count) */
+#define TRACE_BUS               0x80    /**< AS399x bus transaction, see above */
+#define TRACE_BUS_READ          0x40
+#define TRACE_BUS_LEN           0x3f
+
+/* Recording modes, see traceSetMode() */
+#define TRACE_MODE_OFF          0       /**< nothing is recorded */
+#define TRACE_MODE_RING         1       /**< oldest entries are overwritten, default */
+#define TRACE_MODE_ONESHOT      2       /**< recording stops when the buffer is full */
+
+#if TRACE
+/** Records event id with argument arg */
+void traceRecord(u8 id, u8 arg);
+#define TRACE_EVENT(id, arg) traceRecord((id), (arg))
+#else
+#define TRACE_EVENT(id, arg)
+#endif
+
+#if TRACE && BUSREC
+/** Records a bus transaction, see writeReadAS399x() */
+#define TRACE_BUS_EVENT(first, wlen, rlen) traceRecord(TRACE_BUS | ((rlen) ? TRACE_BUS_READ : 0) | \
+        ((u16)(wlen) + (rlen) > TRACE_BUS_LEN ? TRACE_BUS_LEN : (wlen) + (rlen)), (first))
+#else
+#define TRACE_BUS_EVENT(first, wlen, rlen)
+#endif
+
+/** @return number of recorded entries, 0 if #TRACE is not set */
+u8 traceCount(void);
+
+/** Copies entry index (0 is the oldest) as TRACE_ENTRY_SIZE bytes to dest */
+void traceGet(u8 index, u8 *dest);
+
+/** Removes all entries */
+void traceClear(void);
+
+/** Sets the recording mode, one of TRACE_MODE_OFF, TRACE_MODE_RING, TRACE_MODE_ONESHOT */
+void traceSetMode(u8 mode);
+
+/** @return the current recording mode */
+u8 traceGetMode(void);
+
+#endif
@@ -0,0 +1,104 @@
+#!/usr/bin/perl
+#
+# Converts trace buffer dumps (reports 0x68, see callTraceDump() in
+# usb_commands.c) into Chrome trace event JSON which can be loaded into
+# https://ui.perfetto.dev or chrome://tracing.
+#
+# Input are the reports as hex bytes, one report per line, e.g.
+#   68 38 00 0d 01 04 12 34 02 00 40 35 ...
+# Lines not starting with 68 are ignored.
+#
+# usage: trace2perfetto.pl dump.txt > trace.json
+#
+use strict;
+use warnings;
+
+# fine clock of the firmware: 16/3 us per tick, 16 bit wide
+my $US_PER_TICK = 16 / 3;
+
+my %names = (
+    1    => "Query",
+    2    => "Slot",
+    3    => "RN16",
+    4    => "ACK",
+    5    => "EPC",
+    6    => "ReqRN",
+    7    => "Hop",
+    8    => "LBT",
+    9    => "LBT",
+    0x0A => "USB send",
+    0x0B => "Read",
+);
+
+my @entries;
+while (my $line = <>)
+{
+    $line =~ s/^\s+//;
+    my @b = map { hex } split /[\s,]+/, $line;
+    next if (@b < 4 || $b[0] != 0x68);
+    my $n = $b[3];
+    for (my $i = 0; $i < $n; $i++)
+    {
+        my $o = 4 + 4 * $i;
+        last if ($o + 3 > $#b);
+        push @entries, [ $b[$o], $b[$o + 1], $b[$o + 2] | ($b[$o + 3] << 8) ];
+    }
+}
+
+# unwrap the 16 bit timestamps, gaps longer than ~349ms cannot be detected
+my @events;
+my ($last, $time) = (undef, 0);
+my ($slotStart, $rn16Time);
+foreach my $e (@entries)
+{
+    my ($id, $arg, $ticks) = @$e;
+    $time += defined $last ? (($ticks - $last) & 0xffff) : 0;
+    $last = $ticks;
+    my $ts = sprintf("%.2f", $time * $US_PER_TICK);
+    my $name = $names{$id} // sprintf("event 0x%02x", $id);
+
+    if ($id & 0x80)
+    {   # bus transaction, see TRACE_BUS_EVENT()
+        my $len = $id & 0x3f;
+        my $dir = ($id & 0x40) ? "read" : "write";
+        push @events, qq({"name":"bus $dir","ph":"i","s":"t","ts":$ts,"pid":1,"tid":3,"args":{"first":$arg,"bytes":$len}});
+        next;
+    }
+
+    if ($id == 8)
+    {
+        push @events, qq({"name":"LBT","ph":"B","ts":$ts,"pid":1,"tid":1});
+        next;
+    }
+    if ($id == 9)
+    {
+        push @events, qq({"name":"LBT","ph":"E","ts":$ts,"pid":1,"tid":1});
+        next;
+    }
+    push @events, qq({"name":"$name","ph":"i","s":"t","ts":$ts,"pid":1,"tid":1,"args":{"arg":$arg}});
+
+    # Slices on the second track. TRACE_RN16 is recorded once the RN16 has
+    # been received and TRACE_ACK once the ACK has been transmitted (after the
+    # TX interrupt), so these are not the Gen2 link timings T1 and T2.
+    if ($id == 1 || $id == 2)
+    {
+        $slotStart = $time;
+    }
+    elsif ($id == 3 && defined $slotStart)
+    {
+        my $dur = sprintf("%.2f", ($time - $slotStart) * $US_PER_TICK);
+        my $start = sprintf("%.2f", $slotStart * $US_PER_TICK);
+        push @events, qq({"name":"slot -> RN16","ph":"X","ts":$start,"dur":$dur,"pid":1,"tid":2});
+        $rn16Time = $time;
+        undef $slotStart;
+    }
+    elsif ($id == 4 && defined $rn16Time)
+    {
+        my $dur = sprintf("%.2f", ($time - $rn16Time) * $US_PER_TICK);
+        my $start = sprintf("%.2f", $rn16Time * $US_PER_TICK);
+        push @events, qq({"name":"RN16 -> ACK done","ph":"X","ts":$start,"dur":$dur,"pid":1,"tid":2});
+        undef $rn16Time;
+    }
+}
+
+print "{\"traceEvents\":[\n", join(",\n", @events), "\n]}\n";
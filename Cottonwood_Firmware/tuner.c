@@ -50,7 +50,6 @@
 #include "tuner.h"
 #include "as399x_public.h"
 #include "platform.h"
-#include <math.h>
 
 #ifdef CONFIG_TUNER
 /*------------------------------------------------------------------------- */
@@ -88,7 +87,7 @@ void tunerDebug()
         val = as399xGetReflectedPower( );
         ch_val_i = (s8)((val&0xff) - (noiseval&0xff));
         ch_val_q = (s8)(((val>>8)&0xff) - ((noiseval>>8)&0xff));
-        rf = sqrt(ch_val_i * ch_val_i + ch_val_q * ch_val_q);
+        rf = squareRoot((u16)(ch_val_i * ch_val_i) + (u16)(ch_val_q * ch_val_q));
         CON_print("i=%hhd rf=%hx\n",i,rf);
     }
     for ( i = 0; i < 32; i++)
@@ -98,7 +97,7 @@ void tunerDebug()
         val = as399xGetReflectedPower( );
         ch_val_i = (s8)((val&0xff) - (noiseval&0xff));
         ch_val_q = (s8)(((val>>8)&0xff) - ((noiseval>>8)&0xff));
-        rf = sqrt(ch_val_i * ch_val_i + ch_val_q * ch_val_q);
+        rf = squareRoot((u16)(ch_val_i * ch_val_i) + (u16)(ch_val_q * ch_val_q));
         CON_print("i=%hhd rf=%hx\n",i,rf);
     }
     for ( i = 0; i < 32; i++)
@@ -108,7 +107,7 @@ void tunerDebug()
         val = as399xGetReflectedPower( );
         ch_val_i = (s8)((val&0xff) - (noiseval&0xff));
         ch_val_q = (s8)(((val>>8)&0xff) - ((noiseval>>8)&0xff));
-        rf = sqrt(ch_val_i * ch_val_i + ch_val_q * ch_val_q);
+        rf = squareRoot((u16)(ch_val_i * ch_val_i) + (u16)(ch_val_q * ch_val_q));
         CON_print("i=%hhd rf=%hx\n",i,rf);
     }
 }
@@ -217,6 +217,120 @@ void Serial_SendBufferedChar(u8 ch)
 }
 
 
+#if BINLOG
+/** Binary log frames start with this byte, followed by the code address of
+  the format string (MSB first) and the arguments as given on the stack.
+  Format address 0 is used for CON_hexdump(), followed by length and data. */
+#define BINLOG_SYNC   0xA5
+
+static void conBinByte(u8 ch)
+{
+    if (conSerTxInProgress)
+    {
+        conSerTxInProgress = 0;
+        conSerIdx = 0;
+        while ( check_transmitted_ != AS399X_CMD_TRANSMITTED );
+    }
+
+    conSerArray[conSerIdx] = ch;
+    conSerIdx++;
+
+    if(conSerIdx >= sizeof(conSerArray))
+    {
+        sendArrayN(conSerArray, conSerIdx);
+        conSerTxInProgress = 1;
+    }
+}
+
+static void conBinFlush(void)
+{
+    if (!conSerTxInProgress && conSerIdx)
+    {
+        sendArrayN(conSerArray, conSerIdx);
+        conSerTxInProgress = 1;
+    }
+}
+
+/*------------------------------------------------------------------------- */
+/** Binary variant of CON_print(). The format string is only scanned for
+  the argument sizes, formatting is done on the host by binlog2txt.pl
+  which reads the strings from the hex file of the same build.
+  */
+void CON_print(void* format,...)
+{
+    u8 *fmt = format;
+    u8 percent = 0;
+    u8 hs = 0;
+    u16 val;
+    va_list argptr;
+
+    va_start(argptr,format);
+    conBinByte(BINLOG_SYNC);
+    conBinByte((u16)fmt >> 8);
+    conBinByte((u16)fmt & 0xff);
+    for ( ; *fmt != '\0'; fmt++)
+    {
+        if (!percent)
+        {
+            if (*fmt == '%')
+            {
+                percent = 1;
+                hs = 0;
+            }
+            continue;
+        }
+        switch (*fmt)
+        {
+        case '%':
+            percent = 0;
+            break;
+        case 'h':
+            hs++;
+            break;
+        case 'X':
+        case 'c':
+        case 'l':
+        case 'D':
+        case 'U':
+        case 'd':
+        case 'u':
+        case 'x':
+            percent = 0;
+            if (hs == 2)
+            {
+                conBinByte((u8)va_arg(argptr,u8));
+                break;
+            }
+            if (hs == 1) val = (unsigned short)va_arg(argptr,unsigned short);
+            else val = (s16)va_arg(argptr,int);
+            conBinByte(val >> 8);
+            conBinByte(val & 0xff);
+            break;
+        default: /* field width */
+            break;
+        }
+    }
+    va_end(argptr);
+    conBinFlush();
+}
+
+void CON_hexdump(const u8 *buffer, u8 length)
+{
+    u8 i;
+
+    conBinByte(BINLOG_SYNC);
+    conBinByte(0);
+    conBinByte(0);
+    conBinByte(length);
+    for (i = 0; i < length; i++)
+    {
+        conBinByte(buffer[i]);
+    }
+    conBinFlush();
+}
+
+#else
+
 #define NO_OF_DIGITS  10 /* maximum digits we can have in a decimal string 4294967295 = 0xffffffff*/
 #define NO_OF_NIBBLES 4
 #define NULL_CHARACTER '\0'
@@ -464,3 +578,4 @@ void CON_hexdump(const u8 *buffer, u8 length)
             CON_print("\n");
         }
 }
+#endif
@@ -0,0 +1,111 @@
+#!/usr/bin/perl
+#
+# Load test for the command layer over a serial line. Requires a firmware
+# built with UARTSUPPORT set in as399x_config.h; the reports are the same as
+# on USB (see usb_commands.c), the length byte is used for framing.
+#
+# Runs inventory rounds (report 0x43, start = 1) back to back and reports
+# rounds per second, tags per second, round latency and the distinct EPCs
+# seen. Any other command can be sent with -c for a quick check.
+#
+# usage: uartloadtest.pl [-d /dev/ttyUSB0] [-b 115200] [-n rounds] [-t timeout_ms]
+#        uartloadtest.pl [-d /dev/ttyUSB0] -c "10 03 00"
+#
+use strict;
+use warnings;
+use Getopt::Std;
+use Time::HiRes qw(time);
+
+my %opt;
+getopts('d:b:n:t:c:v', \%opt) or die "usage: $0 [-d dev] [-b baud] [-n rounds] [-t timeout_ms] [-c hexbytes] [-v]\n";
+my $dev     = $opt{d} // "/dev/ttyUSB0";
+my $baud    = $opt{b} // 115200;   # 48MHz / (2 * 208), see initUART()
+my $rounds  = $opt{n} // 1000;
+my $timeout = ($opt{t} // 1000) / 1000;
+
+system("stty", "-F", $dev, $baud, "raw", "-echo", "-crtscts", "cs8", "-cstopb", "-parenb") == 0
+    or die "could not configure $dev\n";
+open(my $fh, '+<:raw', $dev) or die "$dev: $!\n";
+
+my $rxbuf = "";
+
+sub sendReport
+{
+    my @b = @_;
+    syswrite($fh, pack("C*", @b)) == @b or die "write failed: $!\n";
+}
+
+# returns the next report as array, empty array on timeout
+sub receiveReport
+{
+    my $end = time() + $timeout;
+    for (;;)
+    {
+        if (length($rxbuf) >= 2)
+        {
+            my $len = ord(substr($rxbuf, 1, 1));
+            $len = 2 if ($len < 2);
+            if (length($rxbuf) >= $len)
+            {
+                my @r = unpack("C*", substr($rxbuf, 0, $len));
+                $rxbuf = substr($rxbuf, $len);
+                printf STDERR "<- %s\n", join(" ", map { sprintf("%02x", $_) } @r) if ($opt{v});
+                return @r;
+            }
+        }
+        my $left = $end - time();
+        return () if ($left <= 0);
+        my $rin = "";
+        vec($rin, fileno($fh), 1) = 1;
+        next unless (select(my $rout = $rin, undef, undef, $left));
+        my $n = sysread($fh, my $chunk, 256);
+        die "read failed: $!\n" unless (defined $n);
+        $rxbuf .= $chunk;
+    }
+}
+
+if (defined $opt{c})
+{
+    my @cmd = map { hex } split /[\s,]+/, $opt{c};
+    sendReport(@cmd);
+    while (my @r = receiveReport())
+    {
+        print join(" ", map { sprintf("%02x", $_) } @r), "\n";
+    }
+    exit 0;
+}
+
+my ($tags, $timeouts, $maxLatency, $sumLatency) = (0, 0, 0, 0);
+my %epcs;
+my $start = time();
+for (my $i = 0; $i < $rounds; $i++)
+{
+    my $t0 = time();
+    sendReport(0x43, 0x03, 0x01);
+    for (;;)
+    {
+        my @r = receiveReport();
+        if (!@r)
+        {
+            $timeouts++;
+            last;
+        }
+        next unless ($r[0] == 0x44);
+        if ($r[1] > 5)
+        {   # byte 7 is epclen + 2, epc starts at byte 10
+            $tags++;
+            $epcs{join("", map { sprintf("%02x", $_) } @r[10 .. 10 + $r[7] - 3])}++;
+        }
+        last if ($r[2] <= 1);
+    }
+    my $lat = time() - $t0;
+    $sumLatency += $lat;
+    $maxLatency = $lat if ($lat > $maxLatency);
+}
+my $elapsed = time() - $start;
+
+printf "rounds:        %d in %.2fs, %.1f rounds/s\n", $rounds, $elapsed, $rounds / $elapsed;
+printf "tags:          %d, %.1f tags/s, %d distinct\n", $tags, $tags / $elapsed, scalar keys %epcs;
+printf "round latency: avg %.2fms max %.2fms\n", 1000 * $sumLatency / $rounds, 1000 * $maxLatency;
+printf "timeouts:      %d\n", $timeouts;
+exit($timeouts ? 1 : 0);
@@ -53,12 +53,17 @@
 #include "tuner.h"
 #endif
 #include "F340_FlashPrimitives.h"
+#include "macro.h"
+#include "encoder.h"
+#include "crc16.h"
+#include "tagcache.h"
+#include "sched.h"
+#include "trace.h"
+#include "bench.h"
+#include "watchlist.h"
 
 #define USBCOMMDEBUG            0
 
-#define SESSION_GEN2            1
-#define SESSION_ISO6B           2
-
 #define UART_IDLE               0x02
 #define UART_RECEIVE            0x03
 #define UART_PROCESS            0x04
@@ -101,6 +106,76 @@ static u8 timedOut;
 static u8 dontResetUSBReceiverFlag;
 static u8 cyclic = 0;
 static u8 cyclicInventStart;
+/** If set hopChannelRelease() keeps the carrier on until the allocation time
+  * of the channel expired, see callCarrierHold() */
+static u8 carrierHold;
+/** Set while the carrier is kept on by carrierHold */
+static u8 channelHeld;
+/** Set if hopFrequencies() reused the held channel, the carrier stayed on since the last command */
+static u8 channelReused;
+/** Set while tags_[1] holds the handle of the tag selected by powerAndSelectTag(), valid
+  * as long as gen2GetRoundCount() equals handleRound and the carrier stays on */
+static u8 handleValid;
+static u16 handleRound;
+/** Number of commands which reused the handle of the last one */
+static u16 handleReuses;
+/** Time in ms without activity before the AS399x is powered down, see callPowerControl() */
+static u16 powerDownDelay;
+/** Set while TIMER_SOFT_POWERDOWN runs for a power down */
+static u8 powerDownPending;
+/** Low power mode between cyclic inventory rounds, one of CYCLIC_DUTY_OFF, ... */
+static u8 cyclicDutyMode = CYCLIC_DUTY_OFF;
+/** Time between cyclic inventory rounds in ms if cyclicDutyMode is set */
+static u16 cyclicOffTime;
+static u8 cyclicSleeping;
+static u8 cyclicWakePending;
+static struct timerStopwatch cyclicWakeWatch;
+/** Time from leaving low power mode until start of inventory round in us */
+static u16 cyclicWakeLatency;
+static u16 cyclicPhaseStart;
+/** Time spent awake and in low power mode in slow ticks */
+static u32 cyclicOnTicks, cyclicOffTicks;
+
+/** Times of the last inventory round in us, see callInventoryStats() */
+static u32 statLbt_us, statAir_us, statUsb_us;
+static struct timerStopwatch statWatch;
+/** If set the statistics are sent after every cyclic inventory round */
+static u8 statAppend;
+
+/** Adaptive link profile control, see callProfileControl() */
+#define PROFILE_MAX             6
+/** Failed singulations in % above which a more robust profile is used */
+#define PROFILE_ERR_UP          20
+/** Failed singulations in % below which a faster profile is tried ... */
+#define PROFILE_ERR_DOWN        5
+/** ... after this number of rounds in a row */
+#define PROFILE_GOOD_ROUNDS     8
+/** Number of profiles in profileList, 0 if the controller is off */
+static u8 profileCount;
+/** Profiles ordered fastest first, linkFreq << 4 | miller << 2 | tari */
+static u8 profileList[PROFILE_MAX];
+static u8 profileIdx;
+static u8 profileGoodRounds;
+/** Population above which a more robust profile is used */
+static u8 profileDense;
+/** Profile used in the last inventory round */
+static u8 profileRound;
+
+/** Inventory state carried over from round to round across hops and antennas,
+  * see inventoryQ() and inventoryLearn() */
+static u8 invQ = 4;
+/** Mean duration of one slot in us, 0 if not yet measured */
+static u16 invSlot_us;
+
+#if WATCHLIST
+/** Bytes of the watchlist filter per chunk in callWatchlist() */
+#define WATCHLIST_CHUNK         56
+/** Cyclic inventory rounds without match after which an alive report is sent, 0 for none */
+static u8 watchAlive;
+static u8 watchRounds;
+/** Tags found in the last round before filtering */
+static u8 watchSeen;
+#endif
 
 #if UARTSUPPORT
 static u8 uartState=UART_IDLE;
@@ -109,11 +184,11 @@ static u8 uartFlag;
 #endif
 
 #if UARTSUPPORT
-#define SendPacket( A ) uartSendPacket()
 void uartSendPacket( )
 {
     u8 i;
 
+    TRACE_EVENT(TRACE_USB_SEND, IN_PACKET[0]);
     for (i=0;i<IN_PACKET[1];i++)      /* and send it back */
         sendByte(IN_PACKET[i]); 
 }
@@ -144,11 +219,19 @@ void lockUnlock(void);
 void usb_gen2KillTag(void);
 void NXPCommands(void);
 void genericCommand(void);
-
-static void hopChannelRelease(void);
-static s8 hopFrequencies(void);
-
-static bool continueCheckTimeout( ) 
+static void sendInventoryStats(void);
+static void profileUpdate(void);
+static bool carrierHoldExpired(void);
+static void carrierHoldService(void);
+static void channelRelease(void);
+static void powerDownIdle(void);
+static bool powerDownDue(void);
+static void powerDownService(bool activity);
+static u8 inventoryQ(void);
+static void inventoryLearn(u32 air_us);
+static void lockMask(u8 action, u8 space, u8 *mask);
+
+bool continueCheckTimeout( ) 
 {
     if (maxSendingLimit_slowTicks == 0) return 1;
     if ( timerMeasure_slowTicks() > maxSendingLimit_slowTicks )
@@ -164,7 +247,7 @@ static bool continueCheckTimeout( )
 
 /* This function checks the current session, if necessary closes it
 and opens a new session */
-static void checkAndSetSession( u8 newSession )
+void checkAndSetSession( u8 newSession )
 {
     if (currentSession == newSession) return;
     switch (currentSession)
@@ -308,7 +391,18 @@ void sendFirmwareHardwareID(void)
 static int powerAndSelectTag( void )
 {
     if (selectedTag == 0) return 0;
-    num_of_tags = gen2SearchForTags(tags_+1,1, (*selectedTag).epc,(*selectedTag).epclen,0,continueCheckTimeout,1); /* To request the handle for writing.... */
+    if (handleValid && channelReused && handleRound == gen2GetRoundCount()
+        && selectedTag->epclen == tags_[1].epclen
+        && !memcmp(selectedTag->epc, tags_[1].epc, tags_[1].epclen)
+        && gen2CheckHandle(tags_+1) == GEN2_OK)
+    {   /* the tag is still open from the last command on the held channel */
+        num_of_tags = 1;
+        selectedTag = tags_+1;
+        handleReuses++;
+        return 1;
+    }
+    handleValid = 0;
+    num_of_tags = gen2SearchForTagsTimeout(tags_+1,1, (*selectedTag).epc,(*selectedTag).epclen,0,maxSendingLimit_slowTicks,1); /* To request the handle for writing.... */
     {
         u8 i, allZero = 1;
         for ( i = 0; i < selectedTag->epclen; i++ )
@@ -318,7 +412,7 @@ static int powerAndSelectTag( void )
         }
         if (num_of_tags == 0 && allZero)
         {
-            num_of_tags = gen2SearchForTags(tags_+1,1, (*selectedTag).epc,(*selectedTag).epclen,gen2qbegin,continueCheckTimeout,0); /* mask, masklength, q */
+            num_of_tags = gen2SearchForTagsTimeout(tags_+1,1, (*selectedTag).epc,(*selectedTag).epclen,gen2qbegin,maxSendingLimit_slowTicks,0); /* mask, masklength, q */
         }
     }
     if (num_of_tags == 0)
@@ -330,6 +424,8 @@ static int powerAndSelectTag( void )
     else
     {
         selectedTag = tags_+1;
+        handleValid = 1;
+        handleRound = gen2GetRoundCount();
     }
 //    return num_of_tags;
 }
@@ -823,6 +919,8 @@ void readRegister(void)
                          2 = 25 us
                        </td></tr>
     <tr><td>qbegin</td><td>0 .. 15. Initial gen2 round is 2^qbegin long. Please be careful with higher values.
+                       Following inventory rounds (callInventoryRSSI()) adapt q to the estimated tag
+                       population and the remaining allocation time of the channel.
                        </td></tr>
     </table>
  */
@@ -839,6 +937,7 @@ void configGen2()
     if (getBuffer_[8]) gen2Configuration.trext    = getBuffer_[9];
     if (getBuffer_[10]) gen2Configuration.tari    = getBuffer_[11];
     if (getBuffer_[12]) gen2qbegin                = getBuffer_[13];
+    if (getBuffer_[6] || getBuffer_[12]) invQ     = gen2qbegin;
 
     memset(IN_PACKET,0,IN_GEN2_SETTINGS_IDSize+1);
 
@@ -1546,7 +1645,9 @@ void callInventory(void)
     do
     {
         inventory();
+        timerStopwatchStart(&statWatch);
         SendPacket(IN_INVENTORY_ID);
+        statUsb_us += timerStopwatch_us(&statWatch);
         getBuffer_[2] = NEXTTID;
     }
     while( (IN_PACKET[2]!=0) && (IN_PACKET[2]!=1) );
@@ -1566,10 +1667,15 @@ void inventory(void)
         CON_print("START\n");
 #endif
         checkAndSetSession(SESSION_GEN2);
+        timerStopwatchStart(&statWatch);
         result = hopFrequencies();
+        statLbt_us = timerStopwatch_us(&statWatch);
+        statUsb_us = 0;
         element = 0;
         num_of_tags = 0;
-        if ( !result) num_of_tags = gen2SearchForTags(tags_,ARRAY_SIZE(tags_),mask,0,gen2qbegin,continueCheckTimeout,1); /* mask, masklength, q */
+        timerStopwatchStart(&statWatch);
+        if ( !result) num_of_tags = gen2SearchForTagsTimeout(tags_,ARRAY_SIZE(tags_),mask,0,gen2qbegin,maxSendingLimit_slowTicks,1); /* mask, masklength, q */
+        statAir_us = timerStopwatch_us(&statWatch);
         hopChannelRelease();
     }
     IN_BUFFER.Ptr = IN_PACKET;
@@ -1626,10 +1732,21 @@ void callInventoryRSSIInternal(u8 startInvent)
     do
     {
         inventoryRSSI(startInvent);
+#if WATCHLIST
+        if (startInvent == STARTINVENTORY && cyclic && watchlistGetK() && num_of_tags == 0)
+        {   /* no tag of the watchlist found, see callWatchlist() */
+            if (!watchAlive || ++watchRounds < watchAlive) break;
+            watchRounds = 0;
+        }
+#endif
+        timerStopwatchStart(&statWatch);
         SendPacket(IN_INVENTORY_ID);
+        statUsb_us += timerStopwatch_us(&statWatch);
+        BENCH_END(BENCH_REPORT);
         startInvent = NEXTTID;
     }
     while( (IN_PACKET[2]!=0) && (IN_PACKET[2]!=1) );
+    if (cyclic && statAppend) sendInventoryStats();
 }
 
 void callInventoryRSSI(void)
@@ -1653,17 +1770,42 @@ void inventoryRSSI(u8 startinvent)
     if (startinvent == STARTINVENTORY)
     {
         checkAndSetSession(SESSION_GEN2);
+        timerStopwatchStart(&statWatch);
         result = hopFrequencies();
+        statLbt_us = timerStopwatch_us(&statWatch);
+        statUsb_us = 0;
         element = 0;
         num_of_tags = 0;
 #if 0
-        if( !result ) num_of_tags = gen2SearchForTags(tags_,ARRAY_SIZE(tags_), mask,0,gen2qbegin,continueCheckTimeout,1); /* mask, masklength, q */
+        if( !result ) num_of_tags = gen2SearchForTagsTimeout(tags_,ARRAY_SIZE(tags_), mask,0,gen2qbegin,maxSendingLimit_slowTicks,1); /* mask, masklength, q */
 #else
-        if( !result ) num_of_tags = gen2SearchForTagsFast(tags_,ARRAY_SIZE(tags_), mask,0,gen2qbegin,continueCheckTimeout, cyclicInventStart); /* mask, masklength, q */
+        if (cyclicWakePending)
+        {
+            u32 latency = timerStopwatch_us(&cyclicWakeWatch);
+            cyclicWakePending = 0;
+            cyclicWakeLatency = (latency > 0xffff) ? 0xffff : latency;
+        }
+        timerStopwatchStart(&statWatch);
+        BENCH_BEGIN(BENCH_ROUND);
+        if( !result )
+        {   /* in cyclic mode a command from the host ends the round early */
+            if (cyclic) num_of_tags = gen2SearchForTagsFastTimeoutOrAbort(tags_,ARRAY_SIZE(tags_), mask,0,inventoryQ(),maxSendingLimit_slowTicks, cyclicInventStart);
+            else num_of_tags = gen2SearchForTagsFastTimeout(tags_,ARRAY_SIZE(tags_), mask,0,inventoryQ(),maxSendingLimit_slowTicks, cyclicInventStart);
+        }
+        BENCH_END(BENCH_ROUND);
 #endif
+        statAir_us = timerStopwatch_us(&statWatch);
+        if (!result) inventoryLearn(statAir_us);
         cyclicInventStart = 0;
         hopChannelRelease();
+#if WATCHLIST
+        watchSeen = num_of_tags;
+        if (watchlistGetK()) num_of_tags = watchlistFilter(tags_, num_of_tags);
+#endif
+        profileRound = profileList[profileIdx];
+        if (!result) profileUpdate();
     }
+    BENCH_BEGIN(BENCH_REPORT);
     if (element < num_of_tags)
     {
         IN_PACKET[1] = tags_[element].epclen + 2 + 8;
@@ -1671,6 +1813,11 @@ void inventoryRSSI(u8 startinvent)
         IN_PACKET[8] = tags_[element].pc[0];
         IN_PACKET[9] = tags_[element].pc[1];
         copyBuffer(tags_[element].epc, &IN_PACKET[10], tags_[element].epclen);
+        if (profileCount)
+        {   /* link profile the tag was read with, see callProfileControl() */
+            IN_PACKET[10 + tags_[element].epclen] = profileRound;
+            IN_PACKET[1]++;
+        }
         IN_PACKET[3] = tags_[element].rssi;
         IN_PACKET[4] = Frequencies.freq[currentFreqIdx] & 0xff;
         IN_PACKET[5] = (Frequencies.freq[currentFreqIdx] >>  8) & 0xff;
@@ -1680,6 +1827,9 @@ void inventoryRSSI(u8 startinvent)
     {
         IN_PACKET[1] = 5;
         IN_PACKET[4] = 0;
+#if WATCHLIST
+        if (watchlistGetK()) IN_PACKET[3] = watchSeen;
+#endif
     }
     if (num_of_tags)
     {
@@ -1722,7 +1872,7 @@ void selectTag(void)
     if (!status )
     {
         u8 i, allZero = 1;
-        num_of_tags = gen2SearchForTags(tags_,1, &getBuffer_[3], getBuffer_[2],0,continueCheckTimeout,1); /* mask, masklength, q */
+        num_of_tags = gen2SearchForTagsTimeout(tags_,1, &getBuffer_[3], getBuffer_[2],0,maxSendingLimit_slowTicks,1); /* mask, masklength, q */
         for ( i = 0; i < getBuffer_[2]; i++ )
         {
             if (getBuffer_[3 + i] != 0)
@@ -1730,7 +1880,7 @@ void selectTag(void)
         }
         if (num_of_tags == 0 && allZero)
         {
-            num_of_tags = gen2SearchForTags(tags_,1, &getBuffer_[3], getBuffer_[2],gen2qbegin,continueCheckTimeout,0); /* mask, masklength, q */
+            num_of_tags = gen2SearchForTagsTimeout(tags_,1, &getBuffer_[3], getBuffer_[2],gen2qbegin,maxSendingLimit_slowTicks,0); /* mask, masklength, q */
         }
     }
     hopChannelRelease();
@@ -1786,6 +1936,7 @@ u8 writeMEM(u8 memAdress,Tag *tag, u8 *data_buf, u8 data_length_words, u8 mem_ty
     u8 length = 0;
     u8 count;
 
+    tagcacheInvalidate(tag);
     while (length < data_length_words)
     {
         /*writing pc into tag */
@@ -1861,7 +2012,7 @@ static void applyTunerSettingForFreq(u32 freq)
         return;
 
     //find the best matching frequency
-    best = 1.0e4;
+    best = 10000;
     idx = 0;
     for(i=0; i<tuningTable.tableSize; i++)
     {
@@ -2227,13 +2378,14 @@ void callChangeFreq(void)
 /*!This function reads from a previously selected gen2 tag.
   The format of the report from the host is as follows:
   <table>
-    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>       2</th><th>      3</th><th>             4</th></tr>
-    <tr><th>Content</th><td>0x37(ID)</td><td>length</td><td>mem_type</td><td>address</td><td>data_len</td></tr>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>       2</th><th>      3</th><th>             4</th><th>    5</th></tr>
+    <tr><th>Content</th><td>0x37(ID)</td><td>length</td><td>mem_type</td><td>address</td><td>data_len</td><td>flags</td></tr>
   </table>
 where 
 <ul>
 <li>mem_type:<ul><li>0:reserved membank</li><li>1:EPC membank</li><li>2:TID membank</li><li>3:USER membank</li></ul>
 <li>data_len: data length to read in 16-bit words</li>
+<li>flags: optional, bit 0 set reads from the tag even if the data is cached (see callTagCache())</li>
 </ul>
   The device sends back the following report:
   <table>
@@ -2261,6 +2413,13 @@ void readDataFromTag(void)
 
     datalen = getBuffer_[4];
 
+    if (datalen && !(getBuffer_[1] > 5 && (getBuffer_[5] & READ_FLAG_BYPASS_CACHE))
+        && selectedTag && tagcacheRead(selectedTag, getBuffer_[2], getBuffer_[3], datalen, &IN_PACKET[4]))
+    {   /* no need to singulate the tag */
+        status = GEN2_OK;
+        goto reply;
+    }
+
     POWER_AND_SELECT_TAG();
 
     if (datalen == 0)
@@ -2279,10 +2438,12 @@ void readDataFromTag(void)
     else
     {
         status = gen2ReadFromTag(selectedTag, getBuffer_[2], getBuffer_[3], datalen, &IN_PACKET[4]);
+        if (!status) tagcacheStore(selectedTag, getBuffer_[2], getBuffer_[3], datalen, &IN_PACKET[4]);
     }
 
 exit:
     hopChannelRelease();
+reply:
     IN_PACKET[0] = IN_READ_FROM_TAG_ID;
     IN_PACKET[2] = status;
     IN_PACKET[1] = 2*datalen + 4;
@@ -2351,56 +2512,58 @@ void lockUnlock(void)
     if (status != 0)
         goto exit;
 
-    if (getBuffer_[2] == 0x01) getBuffer_[2]=0x02;
-    else if (getBuffer_[2] == 0x02) getBuffer_[2]=0x01; /* To adapt to description */
+    lockMask(getBuffer_[2], getBuffer_[3], mask);
+
+#if USBCOMMDEBUG
+    CON_print("LOCK UNLOCK Tag\n");
+#endif
+    status= gen2LockTag(selectedTag, mask);
+
+exit:
+    hopChannelRelease();
+    IN_PACKET[0] = IN_LOCK_UNLOCK_ID;
+    IN_PACKET[1] = IN_WRITE_TO_TAG_IDSize+1;
+    IN_PACKET[2] = status;
+    IN_BUFFER.Length = IN_BUFFER.Ptr[1];
+    IN_BUFFER.Ptr = IN_PACKET;
+    SendPacket(IN_LOCK_UNLOCK_ID);
+
+}
+
+/* Builds the mask and action bytes of the Lock command for lock_unlock and
+   memory_space as given to callLockUnlock() */
+static void lockMask(u8 action, u8 space, u8 *mask)
+{
+    if (action == 0x01) action=0x02;
+    else if (action == 0x02) action=0x01; /* To adapt to description */
     mask[0]=0;
     mask[1]=0;
     mask[2]=0;
-    if      (getBuffer_[3] ==0x00)
+    if      (space ==0x00)
     {
         mask[0]=0xC0;
-        mask[1]= (getBuffer_[2]<<4)&0x30;
+        mask[1]= (action<<4)&0x30;
     }
-    else if (getBuffer_[3] ==0x01)
+    else if (space ==0x01)
     {
         mask[0]=0x30;
-        mask[1]= (getBuffer_[2]<<2)&0x0C;
+        mask[1]= (action<<2)&0x0C;
     }
-    else if (getBuffer_[3] ==0x02)
+    else if (space ==0x02)
     {
         mask[0]=0x0C;
-        mask[1]= (getBuffer_[2]   )&0x03;
+        mask[1]= (action   )&0x03;
     }
-    else if (getBuffer_[3] ==0x03)
+    else if (space ==0x03)
     {
         mask[0]=0x03;
-        mask[2]= (getBuffer_[2]<<6)&0xC0;
+        mask[2]= (action<<6)&0xC0;
     }
-    else if (getBuffer_[3] ==0x04)
+    else if (space ==0x04)
     {
         mask[1]=0xC0;
-        mask[2]= (getBuffer_[2]<<4)&0x30;
+        mask[2]= (action<<4)&0x30;
     }
-    else
-    {
-        mask[0]=0x00;
-        mask[1]=0x00;
-    }
-
-#if USBCOMMDEBUG
-    CON_print("LOCK UNLOCK Tag\n");
-#endif
-    status= gen2LockTag(selectedTag, mask);
-
-exit:
-    hopChannelRelease();
-    IN_PACKET[0] = IN_LOCK_UNLOCK_ID;
-    IN_PACKET[1] = IN_WRITE_TO_TAG_IDSize+1;
-    IN_PACKET[2] = status;
-    IN_BUFFER.Length = IN_BUFFER.Ptr[1];
-    IN_BUFFER.Ptr = IN_PACKET;
-    SendPacket(IN_LOCK_UNLOCK_ID);
-
 }
 
 /*!This function kills a gen2 tag.
@@ -2594,12 +2757,17 @@ void callEnableBootloader(void)
 /*! This function starts/stops the automatic scanning procedure.
   The format of the report from the host is as follows:
   <table>
-    <tr><th>   Byte</th><th>       0</th><th>        1</th><th>     2</th><th>    3</th></tr>
-    <tr><th>Content</th><td>0x5d(ID)</td><td>4(length)</td><td>update</td><td>start</td></tr>
+    <tr><th>   Byte</th><th>       0</th><th>        1</th><th>     2</th><th>    3</th><th>        4</th><th>        5-6</th></tr>
+    <tr><th>Content</th><td>0x5d(ID)</td><td>4 or 7(length)</td><td>update</td><td>start</td><td>duty mode</td><td>off time in ms</td></tr>
   </table>
   To start inventory rounds update has to be set to 1 and start has to be set to 1. To stop inventory rounds
   update has to be set to 1 and start has to be set to 0. If update is set to 0 no change of the current settings will be
   done.
+  The optional duty mode selects the low power mode used for off time between two inventory rounds:
+  0 (CYCLIC_DUTY_OFF) for continuous inventory rounds, 1 (CYCLIC_DUTY_STANDBY) for standby or
+  2 (CYCLIC_DUTY_POWERDOWN) for power down of the AS399x. Meanwhile the CPU is in idle mode.
+  Any received command wakes up the reader. Measured duty cycle and wake up latency are
+  reported by callSysStatus().
   The device sends back:
   <table>
     <tr><th>   Byte</th><th>       0</th><th>        1</th><th>2</th></tr>
@@ -2617,6 +2785,16 @@ void callStartStop(void)
     {
         cyclic = getBuffer_[3];
         cyclicInventStart = 1;
+        cyclicDutyMode = CYCLIC_DUTY_OFF;
+        if (USB_COMM_LEN >= 7 && getBuffer_[4] <= CYCLIC_DUTY_POWERDOWN)
+        {
+            cyclicDutyMode = getBuffer_[4];
+            cyclicOffTime = getBuffer_[5] | (getBuffer_[6] << 8);
+        }
+        cyclicOnTicks = 0;
+        cyclicOffTicks = 0;
+        cyclicWakeLatency = 0;
+        cyclicPhaseStart = timerSlowTicks();
     }
 #ifdef POWER_DETECTOR
     as399xInitCyclicPowerRegulation(OUTPUTPOWER_QUERYCYCLES);
@@ -2628,7 +2806,10 @@ void callStartStop(void)
     IN_PACKET[2] = cyclic;
     SendPacket(IN_START_STOP_ID);
     if(!cyclic)
-        as399xEnterPowerDownMode();
+    {
+        if (channelHeld) channelRelease();
+        powerDownIdle();
+    }
 }
 
 void callGenericCommand(void)
@@ -2760,6 +2941,7 @@ void genericCommand(void)
     cmdData.actRxByteCount = 0;
 
 	memset(&IN_PACKET[4], 0x00, EP1_PACKET_SIZE - 4);
+	tagcacheInvalidate(selectedTag); /* the command may write */
 	status = gen2GenericCommand(selectedTag, &cmdData);
 
 exit:
@@ -2777,6 +2959,1056 @@ exit:
 	SendPacket(IN_GENERIC_COMMAND_ID);
 }
 
+/*! This function loads, starts and stops macro programs, see macro.h for
+  the program format.
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>      2</th><th>     3</th><th>  4</th><th>5..</th></tr>
+    <tr><th>Content</th><td>0x61(ID)</td><td>length</td><td>0 (stop)</td><td>      </td><td>   </td><td>   </td></tr>
+    <tr><th>Content</th><td>0x61(ID)</td><td>length</td><td>1 (load)</td><td>offset</td><td>len</td><td>code</td></tr>
+    <tr><th>Content</th><td>0x61(ID)</td><td>length</td><td>2 (start)</td><td>cycles</td><td> </td><td>   </td></tr>
+  </table>
+  A program larger than one report is loaded using several load reports with
+  increasing offset. cycles is the number of program cycles to execute, 0 runs
+  the program until it is stopped. Any other command received also stops the program.
+  The device sends back:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>        1</th><th>     2</th><th>      3</th></tr>
+    <tr><th>Content</th><td>0x62(ID)</td><td>4(length)</td><td>status</td><td>running</td></tr>
+  </table>
+  Subsequently the running program sends reports as described in macro.h.
+ */
+void callMacroCommand(void)
+{
+    u8 status = 0;
+
+#if USBCOMMDEBUG
+    CON_print("MACRO: %hhx\n", getBuffer_[2]);
+#endif
+    switch (getBuffer_[2])
+    {
+        case 0:
+            macroStop();
+            break;
+        case 1:
+            if (getBuffer_[4] > OUT_MACRO_IDSize - 4)
+                status = MACRO_ERR_PROGRAM;
+            else
+                status = macroLoad(getBuffer_[3], &getBuffer_[5], getBuffer_[4]);
+            break;
+        case 2:
+            status = macroStart(getBuffer_[3]);
+            break;
+        default:
+            status = MACRO_ERR_PROGRAM;
+            break;
+    }
+    IN_PACKET[0] = IN_MACRO_ID;
+    IN_PACKET[1] = 4;
+    IN_PACKET[2] = status;
+    IN_PACKET[3] = macroIsRunning();
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_MACRO_IDSize+1;
+    SendPacket(IN_MACRO_ID);
+    if (!macroIsRunning())
+    {
+        if (channelHeld) channelRelease();
+        powerDownIdle();
+    }
+}
+
+/*! This function configures, starts and stops the bulk encoding job, see encoder.h.
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>       2</th><th>     3</th><th>        4</th><th>       5</th><th>       6</th><th>7 ..</th><th>7 + blank_len ..</th></tr>
+    <tr><th>Content</th><td>0x77(ID)</td><td>length</td><td>0 (stop)</td><td>      </td><td>         </td><td>        </td><td>        </td><td>    </td><td>                </td></tr>
+    <tr><th>Content</th><td>0x77(ID)</td><td>length</td><td>1 (setup)</td><td>words</td><td>serial_pos</td><td>serial_len</td><td>blank_len</td><td>blank</td><td>epc template</td></tr>
+  </table>
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>        2</th><th>3 .. 6</th><th>   7 .. 8</th><th>9 .. 10</th><th>11 .. 14</th><th>15 .. 17</th></tr>
+    <tr><th>Content</th><td>0x77(ID)</td><td>length</td><td>2 (start)</td><td>serial</td><td>increment</td><td>count</td><td>acces_pw</td><td>lock</td></tr>
+  </table>
+  setup sets an EPC template of words words, the serial number of serial_len bytes is
+  put MSB first at byte serial_pos of it. Tags whose EPC starts with blank are encoded.
+  start begins with serial, which is incremented by increment after each encoded tag,
+  and stops after count tags, 0 runs until the job is stopped. If acces_pw is not 0 the
+  tags are accessed before writing. If lock is not 0 the tags are locked with this mask
+  and action (see gen2LockTag()) after verifying. Any other command also stops the job.
+  The device sends back:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>         1</th><th>     2</th><th>      3</th><th>4 .. 7</th><th>8 .. 9</th></tr>
+    <tr><th>Content</th><td>0x78(ID)</td><td>10(length)</td><td>status</td><td>running</td><td>serial</td><td>encoded</td></tr>
+  </table>
+  serial is the serial number of the next tag, encoded the number of tags encoded since
+  start. Subsequently the running job sends a report for every tag, see encoderReport().
+ */
+void callEncoder(void)
+{
+    u8 status = 0;
+    u8 words = getBuffer_[3];
+    u8 blankLen = getBuffer_[6];
+
+    switch (getBuffer_[2])
+    {
+        case 0:
+            encoderStop();
+            break;
+        case 1:
+            if (7 + blankLen + 2 * words > OUT_ENCODER_IDSize + 1)
+                status = ENCODER_ERR_PARAM;
+            else
+                status = encoderSetup(&getBuffer_[7 + blankLen], words, getBuffer_[4], getBuffer_[5],
+                                      &getBuffer_[7], blankLen);
+            break;
+        case 2:
+            status = encoderStart(getBuffer_[3] | ((u32)getBuffer_[4] << 8) | ((u32)getBuffer_[5] << 16) | ((u32)getBuffer_[6] << 24),
+                                  getBuffer_[7] | (getBuffer_[8] << 8), getBuffer_[9] | (getBuffer_[10] << 8),
+                                  &getBuffer_[11], &getBuffer_[15]);
+            break;
+        default:
+            status = ENCODER_ERR_PARAM;
+            break;
+    }
+    IN_PACKET[0] = IN_ENCODER_ID;
+    IN_PACKET[1] = 10;
+    IN_PACKET[2] = status;
+    IN_PACKET[3] = encoderIsRunning();
+    u32ToBuffer(encoderSerial(), &IN_PACKET[4]);
+    u16ToBuffer(encoderEncoded(), &IN_PACKET[8]);
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_ENCODER_IDSize+1;
+    SendPacket(IN_ENCODER_ID);
+    if (!encoderIsRunning())
+    {
+        if (channelHeld) channelRelease();
+        powerDownIdle();
+    }
+}
+
+/*! This function reports the system status. Currently this is the CPU load
+  measured by the scheduler since the last call of this command.
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>        1</th></tr>
+    <tr><th>Content</th><td>0x63(ID)</td><td>2(length)</td></tr>
+  </table>
+  The device sends back:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>         1</th><th>                  2</th><th>                3-6</th><th>         7-10</th><th>            11</th><th>           12-13</th></tr>
+    <tr><th>Content</th><td>0x64(ID)</td><td>14(length)</td><td>idle time in percent</td><td>measurement time in ms</td><td>idle time in ms</td><td>duty cycle in percent</td><td>wake up latency in us</td></tr>
+  </table>
+  Multi byte values are sent LSB first. Idle time is the time the CPU was waiting
+  (see schedWait_us()) or had no command to process.
+  Duty cycle is the time the AS399x was awake during duty cycled cyclic inventory (see
+  callStartStop()), wake up latency is the time from leaving low power mode until the
+  start of the last inventory round, 0xffff if above 65ms.
+ */
+void callSysStatus(void)
+{
+    u32 idleMs, totalMs;
+
+    schedGetLoad(&idleMs, &totalMs);
+    if (idleMs > totalMs) idleMs = totalMs;
+    IN_PACKET[0] = IN_SYS_STATUS_ID;
+    IN_PACKET[1] = 14;
+    IN_PACKET[2] = totalMs ? (idleMs * 100 / totalMs) : 100;
+    IN_PACKET[3] = totalMs & 0xff;
+    IN_PACKET[4] = (totalMs >>  8) & 0xff;
+    IN_PACKET[5] = (totalMs >> 16) & 0xff;
+    IN_PACKET[6] = (totalMs >> 24) & 0xff;
+    IN_PACKET[7] = idleMs & 0xff;
+    IN_PACKET[8] = (idleMs >>  8) & 0xff;
+    IN_PACKET[9] = (idleMs >> 16) & 0xff;
+    IN_PACKET[10] = (idleMs >> 24) & 0xff;
+    IN_PACKET[11] = (cyclicOnTicks + cyclicOffTicks) ? (cyclicOnTicks * 100 / (cyclicOnTicks + cyclicOffTicks)) : 100;
+    IN_PACKET[12] = cyclicWakeLatency & 0xff;
+    IN_PACKET[13] = (cyclicWakeLatency >> 8) & 0xff;
+    cyclicOnTicks = 0;
+    cyclicOffTicks = 0;
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_SYS_STATUS_IDSize+1;
+    SendPacket(IN_SYS_STATUS_ID);
+}
+
+/* Sends the statistics report of the last inventory round, see callInventoryStats() */
+static void sendInventoryStats(void)
+{
+    struct gen2InventoryStats *stats = gen2GetInventoryStats();
+    u16 hits, misses;
+    u8 i;
+
+    IN_PACKET[0] = IN_INVENTORY_STATS_ID;
+    IN_PACKET[1] = 40;
+    u16ToBuffer(stats->slots, &IN_PACKET[2]);
+    u16ToBuffer(stats->empty, &IN_PACKET[4]);
+    u16ToBuffer(stats->singulated, &IN_PACKET[6]);
+    u16ToBuffer(stats->collisions, &IN_PACKET[8]);
+    u16ToBuffer(stats->crcErrors, &IN_PACKET[10]);
+    u16ToBuffer(stats->preambleErrors, &IN_PACKET[12]);
+    for (i = 0; i < 4; i++)
+    {
+        u16ToBuffer(stats->fails[i], &IN_PACKET[14 + 2*i]);
+    }
+    IN_PACKET[22] = stats->q;
+    u32ToBuffer(statLbt_us, &IN_PACKET[23]);
+    u32ToBuffer(statAir_us, &IN_PACKET[27]);
+    u32ToBuffer(statUsb_us, &IN_PACKET[31]);
+    tagcacheGetStats(&hits, &misses, &IN_PACKET[39]);
+    u16ToBuffer(hits, &IN_PACKET[35]);
+    u16ToBuffer(misses, &IN_PACKET[37]);
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_INVENTORY_STATS_IDSize+1;
+    SendPacket(IN_INVENTORY_STATS_ID);
+}
+
+/*! This function reports statistics of the last inventory round.
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>        1</th><th>     2</th></tr>
+    <tr><th>Content</th><td>0x65(ID)</td><td>3(length)</td><td>append</td></tr>
+  </table>
+  If append is 1 the statistics report is additionally sent after each round
+  of cyclic inventory (see callStartStop()), 2 stops this, 0 leaves it unchanged.
+  The device sends back:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>         1</th><th>  2-3</th><th>  4-5</th><th>       6-7</th><th>       8-9</th><th>    10-11</th><th>         12-13</th><th>        14-21</th><th>22</th><th>  23-26</th><th>  27-30</th><th>  31-34</th><th>      35-36</th><th>        37-38</th><th>           39</th></tr>
+    <tr><th>Content</th><td>0x66(ID)</td><td>40(length)</td><td>slots</td><td>empty</td><td>singulated</td><td>collisions</td><td>CRC errors</td><td>preamble errors</td><td>failure class -1 .. -4</td><td>final q</td><td>LBT time</td><td>air time</td><td>USB time</td><td>cache hits</td><td>cache misses</td><td>cache entries</td></tr>
+  </table>
+  Multi byte values are sent LSB first, times are in us. See struct gen2InventoryStats
+  for a description of the counters. LBT time is spent in hopFrequencies() (idle time
+  and listen before talk), air time in the inventory round itself and USB time in sending
+  the tag reports. Cache hits and misses count the reads of readDataFromTag() answered from
+  the tag memory cache or not (see callTagCache()) since the last report, cache entries is
+  the number of entries in use.
+ */
+void callInventoryStats(void)
+{
+    if (getBuffer_[2] == 1) statAppend = 1;
+    if (getBuffer_[2] == 2) statAppend = 0;
+    sendInventoryStats();
+}
+
+/*! This function reads out the trace buffer (see trace.h), oldest entries first.
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>        1</th><th>    2</th></tr>
+    <tr><th>Content</th><td>0x67(ID)</td><td>3(length)</td><td>clear</td></tr>
+  </table>
+  If clear is 1 the trace buffer is emptied after reading. If clear is 2 it is emptied and
+  the next events are recorded only until the buffer is full (one shot, e.g. for busreplay.pl),
+  3 emptied and switched back to ring mode. Recording is paused during the read out.
+  The device sends back one or more reports until all entries are sent:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>                  2</th><th>      3</th><th>4 .. 4 + 4*entries</th></tr>
+    <tr><th>Content</th><td>0x68(ID)</td><td>length</td><td>entries in following reports</td><td>entries</td><td>id, arg, time LSB, time MSB</td></tr>
+  </table>
+  time is the fine clock, see timerFineTicks(). If tracing is not compiled in one report
+  without entries is sent.
+ */
+void callTraceDump(void)
+{
+    u8 mode = traceGetMode();
+    u8 count = traceCount();
+    u8 index = 0;
+    u8 n, i;
+
+    traceSetMode(TRACE_MODE_OFF);
+    do
+    {
+        n = count - index;
+        if (n > (IN_TRACE_DUMP_IDSize - 4) / TRACE_ENTRY_SIZE)
+            n = (IN_TRACE_DUMP_IDSize - 4) / TRACE_ENTRY_SIZE;
+        IN_PACKET[0] = IN_TRACE_DUMP_ID;
+        IN_PACKET[1] = 4 + n * TRACE_ENTRY_SIZE;
+        IN_PACKET[2] = count - index - n;
+        IN_PACKET[3] = n;
+        for (i = 0; i < n; i++)
+        {
+            traceGet(index + i, &IN_PACKET[4 + i * TRACE_ENTRY_SIZE]);
+        }
+        index += n;
+        IN_BUFFER.Ptr = IN_PACKET;
+        IN_BUFFER.Length = IN_TRACE_DUMP_IDSize+1;
+        SendPacket(IN_TRACE_DUMP_ID);
+    } while (index < count);
+    if (getBuffer_[2] >= 1 && getBuffer_[2] <= 3) traceClear();
+    if (getBuffer_[2] == 2) mode = TRACE_MODE_ONESHOT;
+    if (getBuffer_[2] == 3) mode = TRACE_MODE_RING;
+    traceSetMode(mode);
+}
+
+/*! This function reads out the hot path cycle counters (see bench.h).
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>        1</th><th>    2</th></tr>
+    <tr><th>Content</th><td>0x69(ID)</td><td>3(length)</td><td>clear</td></tr>
+  </table>
+  If clear is 1 the counters are reset after reading.
+  The device sends back the following report:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>      2</th><th>3 .. 12</th><th>13 .. 22</th><th>23 .. 32</th><th>33 .. 42</th></tr>
+    <tr><th>Content</th><td>0x6a(ID)</td><td>length</td><td>counters</td><td>tag</td><td>extInt</td><td>round</td><td>report</td></tr>
+  </table>
+  Each counter consists of count (2 bytes), cycles (4 bytes) and maximum cycles of
+  one measurement (4 bytes), all LSB first. counters is 0 if benchmarking is not
+  compiled in.
+ */
+void callBench(void)
+{
+    u8 i;
+
+    IN_PACKET[0] = IN_BENCH_ID;
+    IN_PACKET[1] = 3 + BENCH_NUM * BENCH_ENTRY_SIZE;
+    IN_PACKET[2] = BENCH ? BENCH_NUM : 0;
+    for (i = 0; i < BENCH_NUM; i++)
+    {
+        benchGet(i, &IN_PACKET[3 + i * BENCH_ENTRY_SIZE]);
+    }
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_BENCH_IDSize+1;
+    SendPacket(IN_BENCH_ID);
+    if (getBuffer_[2] == 1) benchClear();
+}
+
+/** Returns q for the next inventory round: the one learned in the previous rounds,
+  * reduced until the round fits into the allocation time left on the current channel,
+  * so that it is not cut off by continueCheckTimeout(). */
+static u8 inventoryQ(void)
+{
+    u8 q = invQ;
+    u16 used_ms;
+    u32 left_us;
+
+    if (maxSendingLimit_slowTicks == 0 || invSlot_us == 0) return q;
+    used_ms = SLOWTICKS_2_MS(timerMeasure_slowTicks());
+    if (used_ms + 16 >= maxSendingTime) return 0;
+    left_us = (u32)(maxSendingTime - 16 - used_ms) * 1000;
+    while (q && ((u32)invSlot_us << q) > left_us) q--;
+    return q;
+}
+
+/** Updates the inventory state from the statistics of the round just finished.
+  * The number of tags is estimated after Schoute, 2.39 tags per collided slot. If
+  * the round was cut short the estimate is extrapolated to the slots not reached.
+  * With session S0 all tags take part again after the carrier was off for the
+  * hop, otherwise only the ones not inventoried yet. */
+static void inventoryLearn(u32 air_us)
+{
+    const struct gen2InventoryStats *stats = gen2GetInventoryStats();
+    u16 frame = 1U << stats->q;
+    u32 tags, slot_us;
+    u8 q;
+
+    if (stats->slots == 0) return;
+
+    slot_us = air_us / stats->slots;
+    if (slot_us > 0xffff) slot_us = 0xffff;
+    invSlot_us = invSlot_us ? (u16)(((u32)invSlot_us * 3 + slot_us) / 4) : (u16)slot_us;
+
+    tags = (u32)stats->collisions * 239 / 100 + stats->fails[1] + stats->fails[2] + stats->fails[3];
+    if (stats->slots < frame)
+        tags = (tags + stats->singulated) * frame / stats->slots - stats->singulated;
+    if (gen2Configuration.session == GEN2_IINV_S0)
+        tags += stats->singulated;
+
+    for (q = 0; q < 15 && (1UL << q) < tags; q++)
+        ;
+    invQ = q;
+}
+
+static void profileApply(u8 profile)
+{
+    gen2Configuration.linkFreq = profile >> 4;
+    gen2Configuration.miller   = (profile >> 2) & 0x03;
+    gen2Configuration.tari     = profile & 0x03;
+    /* gen2Configure() is called by the next checkAndSetSession() */
+    if (currentSession == SESSION_GEN2) currentSession = 0;
+}
+
+/** Chooses the link profile for the next round from the statistics of the last one */
+static void profileUpdate(void)
+{
+    const struct gen2InventoryStats *stats = gen2GetInventoryStats();
+    u16 errors, attempts;
+    u8 next = profileIdx;
+
+    if (!profileCount) return;
+
+    /* each singulation which failed after its RN16 is counted once in fails[],
+       crcErrors and preambleErrors count some of these replies again */
+    errors = stats->fails[1] + stats->fails[2] + stats->fails[3];
+    attempts = stats->singulated + errors;
+    if (attempts == 0) return; /* an empty field tells nothing about the link */
+
+    if ((u32)errors * 100 > (u32)attempts * PROFILE_ERR_UP || stats->singulated > profileDense)
+    {
+        profileGoodRounds = 0;
+        if (next + 1 < profileCount) next++;
+    }
+    else if ((u32)errors * 100 < (u32)attempts * PROFILE_ERR_DOWN)
+    {
+        profileGoodRounds++;
+        if (profileGoodRounds >= PROFILE_GOOD_ROUNDS && next > 0)
+        {
+            profileGoodRounds = 0;
+            next--;
+        }
+    }
+    else
+    {
+        profileGoodRounds = 0;
+    }
+    if (next != profileIdx)
+    {
+        profileIdx = next;
+        profileApply(profileList[next]);
+    }
+}
+
+/*! This function configures the adaptive link profile controller. If enabled the
+  link profile (link frequency, coding, tari, see configGen2()) is chosen before each
+  inventory round (see callInventoryRSSI()) from a list ordered fastest first. A more
+  robust profile is used if more than 20% of the singulations in the last round failed
+  (no reply to the ACK, errors in or wrong length of the EPC) or more than dense tags
+  were found, a faster one after 8 rounds in a row with less than 5% failures and at
+  most dense tags.
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>            2</th><th>    3</th><th>4 .. 4 + count</th></tr>
+    <tr><th>Content</th><td>0x6B(ID)</td><td>length</td><td>count</td><td>dense</td><td>profiles</td></tr>
+  </table>
+  count 0 disables the controller and keeps the current profile, at most 6 profiles are
+  supported. Each profile is coded as linkFreq << 4 | miller << 2 | tari, linkFreq
+  has to be one supported by gen2Configure(), tari at most 2. dense has to be at least 1
+  if count is not 0.
+  While the controller is enabled the inventory reports (0x44) carry the profile the tag
+  was read with as additional byte after the epc.
+  The device sends back:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>        1</th><th>     2</th><th>    3</th><th>    4</th><th>      5</th></tr>
+    <tr><th>Content</th><td>0x6C(ID)</td><td>6(length)</td><td>status</td><td>count</td><td>index</td><td>profile</td></tr>
+  </table>
+  status is 0 on success, 0xff if count is too large or dense or a profile invalid, the
+  previous settings are kept then. index and profile are the ones to be used in the
+  next round.
+ */
+void callProfileControl(void)
+{
+    u8 i;
+    u8 status = 0;
+
+    if (getBuffer_[2] > PROFILE_MAX || (getBuffer_[2] && !getBuffer_[3]))
+    {
+        status = 0xff;
+    }
+    for (i = 0; i < getBuffer_[2] && !status; i++)
+    {
+        if (!gen2LinkFreqSupported(getBuffer_[4 + i] >> 4) || (getBuffer_[4 + i] & 0x03) > 2)
+            status = 0xff;
+    }
+    if (!status)
+    {
+        profileCount = getBuffer_[2];
+        profileDense = getBuffer_[3];
+        for (i = 0; i < profileCount; i++)
+        {
+            profileList[i] = getBuffer_[4 + i];
+        }
+        profileIdx = 0;
+        profileGoodRounds = 0;
+        if (profileCount) profileApply(profileList[0]);
+    }
+
+    IN_PACKET[0] = IN_PROFILE_CTRL_ID;
+    IN_PACKET[1] = 6;
+    IN_PACKET[2] = status;
+    IN_PACKET[3] = profileCount;
+    IN_PACKET[4] = profileIdx;
+    IN_PACKET[5] = profileList[profileIdx];
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_PROFILE_CTRL_IDSize+1;
+    SendPacket(IN_PROFILE_CTRL_ID);
+}
+
+/*! This function enables the carrier hold mode. Normally every command which
+  accesses tags selects a channel with hopFrequencies() (listen before talk, tuning,
+  carrier on) and switches the carrier off at the end, often also powering down the
+  AS399x. In carrier hold mode the carrier stays on after a command and the following
+  commands reuse the channel, e.g. for a read, write, lock sequence, as long as the
+  allocation time (maxSendingTime, see callChangeFreq()) of the channel lasts. Then
+  the carrier is switched off, also without further commands, and the next command
+  selects a new channel.
+  While the carrier is held the tag selected by an access command stays open, the next
+  access command to the same tag only checks its handle with a Req_RN instead of
+  singulating it again with Select and Query (see powerAndSelectTag()).
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>     2</th></tr>
+    <tr><th>Content</th><td>0x71(ID)</td><td>length</td><td>enable</td></tr>
+  </table>
+  enable is 1 to enable, 0 to disable and release a held channel.
+  The device sends back:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>        1</th><th>     2</th><th>     3</th><th>   4</th><th>5 .. 6</th><th>7 .. 8</th></tr>
+    <tr><th>Content</th><td>0x72(ID)</td><td>9(length)</td><td>status</td><td>enable</td><td>held</td><td>time</td><td>reuses</td></tr>
+  </table>
+  held is 1 if the carrier is currently held, time the allocation time left in ms,
+  reuses the number of access commands which reused the handle of the selected tag.
+ */
+void callCarrierHold(void)
+{
+    u16 left = 0;
+
+    carrierHold = (getBuffer_[2] != 0);
+    if (!carrierHold && channelHeld) channelRelease();
+    if (channelHeld && !carrierHoldExpired())
+        left = SLOWTICKS_2_MS(maxSendingLimit_slowTicks - timerMeasure_slowTicks());
+
+    IN_PACKET[0] = IN_CARRIER_HOLD_ID;
+    IN_PACKET[1] = 9;
+    IN_PACKET[2] = 0;
+    IN_PACKET[3] = carrierHold;
+    IN_PACKET[4] = channelHeld;
+    u16ToBuffer(left, &IN_PACKET[5]);
+    u16ToBuffer(handleReuses, &IN_PACKET[7]);
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_CARRIER_HOLD_IDSize+1;
+    SendPacket(IN_CARRIER_HOLD_ID);
+}
+
+/*! This function configures when the AS399x is powered down. After a command the
+  AS399x is normally powered down at once (unless cyclic inventory or a macro program
+  runs), the next command has to wait until it is awake again (about 13ms). With an
+  idle time the AS399x is only powered down if no command was received for this time.
+  Power down saves and wake up restores the register image of the AS399x in bursts.
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>  2</th><th>   3 .. 4</th></tr>
+    <tr><th>Content</th><td>0x73(ID)</td><td>length</td><td>set</td><td>idle time</td></tr>
+  </table>
+  If set is 1 the idle time in ms is set, 0 powers down immediately (default). If set
+  is 0 the values are only reported.
+  The device sends back:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>        1</th><th>     2</th><th>   3 .. 4</th><th>         5 .. 6</th><th>7 .. 8</th></tr>
+    <tr><th>Content</th><td>0x74(ID)</td><td>9(length)</td><td>status</td><td>idle time</td><td>wake up latency</td><td>wake ups</td></tr>
+  </table>
+  wake up latency is the time in us the last wake up took until the first command could
+  be processed, wake ups the number of wake ups since reset. Multi byte values are sent
+  LSB first.
+ */
+void callPowerControl(void)
+{
+    u16 latency, count;
+
+    if (getBuffer_[2] == 1)
+    {
+        powerDownDelay = getBuffer_[3] | (getBuffer_[4] << 8);
+        if (powerDownPending) powerDownIdle();
+    }
+    as399xGetWakeStats(&latency, &count);
+
+    IN_PACKET[0] = IN_POWER_CTRL_ID;
+    IN_PACKET[1] = 9;
+    IN_PACKET[2] = 0;
+    u16ToBuffer(powerDownDelay, &IN_PACKET[3]);
+    u16ToBuffer(latency, &IN_PACKET[5]);
+    u16ToBuffer(count, &IN_PACKET[7]);
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_POWER_CTRL_IDSize+1;
+    SendPacket(IN_POWER_CTRL_ID);
+}
+
+/*! This function manages the EPC watchlist (see watchlist.h), only available if
+  WATCHLIST is set in as399x_config.h. While a watchlist is active callInventoryRSSI()
+  only reports the tags whose EPC is on the list (Bloom filter, a small share of other
+  tags is reported too). The empty report (tags_left 0) carries the number of tags seen
+  in the round in byte 3 instead of the RSSI. During cyclic inventory rounds without a
+  match are not reported, except every alive rounds.
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>   2</th><th>3 .. 62</th></tr>
+    <tr><th>Content</th><td>0x6F(ID)</td><td>length</td><td>op</td><td>see below</td></tr>
+  </table>
+  <table>
+    <tr><th>op</th><th>function</th><th>parameters</th></tr>
+    <tr><td>0</td><td>activate</td><td>[3] k: number of hash functions used when building
+        the filter (1 .. 8), 0 deactivates the watchlist. [4] alive: see above</td></tr>
+    <tr><td>1</td><td>erase</td><td>deactivates the watchlist and erases the filter, this
+        takes about 80ms</td></tr>
+    <tr><td>2</td><td>write</td><td>[3 .. 4] offset, [5] len (at most 56), [6 ..] filter
+        bytes. Each part of the filter (2048 bytes) may only be written once after erase.</td></tr>
+  </table>
+  watchlist.pl builds the filter from a list of EPCs and uploads it.
+  The device sends back:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>        1</th><th>     2</th><th>3</th><th>    4</th></tr>
+    <tr><th>Content</th><td>0x70(ID)</td><td>5(length)</td><td>status</td><td>k</td><td>alive</td></tr>
+  </table>
+  status is 0 on success, 0xff if op or the range is invalid or WATCHLIST is not set.
+ */
+void callWatchlist(void)
+{
+    u8 status = 0;
+
+    IN_PACKET[0] = IN_WATCHLIST_ID;
+    IN_PACKET[1] = 5;
+#if WATCHLIST
+    switch (getBuffer_[2])
+    {
+        case 0:
+            watchlistSetK(getBuffer_[3]);
+            watchAlive = getBuffer_[4];
+            watchRounds = 0;
+            break;
+        case 1:
+            watchlistSetK(0);
+            watchlistErase();
+            break;
+        case 2:
+            if (getBuffer_[5] > WATCHLIST_CHUNK)
+                status = 0xff;
+            else
+                status = watchlistWrite(getBuffer_[3] | (getBuffer_[4] << 8), &getBuffer_[6], getBuffer_[5]);
+            break;
+        default:
+            status = 0xff;
+            break;
+    }
+    IN_PACKET[3] = watchlistGetK();
+    IN_PACKET[4] = watchAlive;
+#else
+    status = 0xff;
+    IN_PACKET[3] = 0;
+    IN_PACKET[4] = 0;
+#endif
+    IN_PACKET[2] = status;
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_WATCHLIST_IDSize+1;
+    SendPacket(IN_WATCHLIST_ID);
+}
+
+/** Largest q used by callTagCount(), limits the fixed point range of estimateTags() */
+#define COUNT_MAXQ              10
+
+/** Estimates the number of tags after Vogt from one round with 2^q slots: the
+  * n >= singles + 2 * collisions for which the expected numbers of empty, single
+  * and collided slots are closest to the observed ones. The expectations are
+  * computed in 1/64 slots, the distance is the sum of the absolute differences.
+  * It has a single minimum in n, so the search ends once it grows again. */
+static u16 estimateTags(u8 q, u16 empty, u16 single, u16 coll)
+{
+    u16 slots = 1U << q;
+    u16 n, lim, best;
+    u32 p = 0x10000UL; /* (1 - 1/slots)^(n-1) in 1/65536 */
+    u32 dist, bestDist = 0xffffffffUL;
+    s32 e0, e1, ec;
+
+    if (coll == 0) return single;
+    best = single + 2 * coll;
+    lim = 4 * slots;
+    if (lim < best) lim = best;
+    for (n = 1; n <= lim; n++)
+    {
+        if (n >= single + 2 * coll)
+        {
+            e0 = ((u32)slots * (p - (p >> q))) >> 10;
+            e1 = ((u32)n * p) >> 10;
+            ec = ((s32)slots << 6) - e0 - e1;
+            e0 -= (s32)empty << 6;
+            e1 -= (s32)single << 6;
+            ec -= (s32)coll << 6;
+            dist = (e0 < 0 ? -e0 : e0) + (e1 < 0 ? -e1 : e1) + (ec < 0 ? -ec : ec);
+            if (dist < bestDist)
+            {
+                bestDist = dist;
+                best = n;
+            }
+            else if (dist > bestDist)
+            {
+                break;
+            }
+        }
+        p -= p >> q;
+    }
+    return best;
+}
+
+/*! This function estimates the number of tags in the field without reading them.
+  Probe rounds (gen2ProbeRound()) are run on one channel, the tags reply with their
+  RN16 but are not acknowledged, so their inventoried flags are not changed. The number
+  of tags is estimated from the empty, single and collided slots of each round
+  (Vogt), q of the next round is adapted to the estimate. Rounds in which more than
+  7/8 of the slots collided are repeated with a larger q and not counted.
+  The result also seeds q of the following inventory rounds (see callInventoryRSSI()).
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>2</th><th>     3</th></tr>
+    <tr><th>Content</th><td>0x6D(ID)</td><td>length</td><td>q</td><td>rounds</td></tr>
+  </table>
+  q is the start q (at most 10), rounds the number of rounds to evaluate (1 .. 16).
+  The device sends back:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>         1</th><th>     2</th><th>3 .. 4</th><th>     5</th><th>6</th><th>7 .. 8</th></tr>
+    <tr><th>Content</th><td>0x6E(ID)</td><td>9(length)</td><td>status</td><td>tags</td><td>rounds</td><td>q</td><td>time</td></tr>
+  </table>
+  status is 0 on success or an error code of hopFrequencies(). tags is the mean estimate
+  of the rounds evaluated, rounds may be less than requested if the allocation time of
+  the channel expired, q is the q of the last round and time the air time in ms.
+ */
+void callTagCount(void)
+{
+    u8 q = getBuffer_[2];
+    u8 rounds = getBuffer_[3];
+    u8 done = 0, tries = 0;
+    u32 sum = 0;
+    u32 air_us;
+    u16 tags = 0;
+    s8 status;
+    const struct gen2InventoryStats *stats = gen2GetInventoryStats();
+
+    if (q > COUNT_MAXQ) q = COUNT_MAXQ;
+    if (rounds == 0) rounds = 1;
+    if (rounds > 16) rounds = 16;
+
+    checkAndSetSession(SESSION_GEN2);
+    status = hopFrequencies();
+    timerStopwatchStart(&statWatch);
+    while (!status && done < rounds && tries < 2 * rounds && continueCheckTimeout())
+    {
+        tries++;
+        gen2ProbeRound(q, continueCheckTimeout);
+        if (stats->slots < (1U << q)) break; /* cut off, not evaluated */
+        if (q < COUNT_MAXQ && stats->collisions > (7U << q) / 8)
+        {
+            q++;
+            continue;
+        }
+        tags = estimateTags(q, stats->empty, stats->singulated, stats->collisions);
+        sum += tags;
+        done++;
+        for (q = 0; q < COUNT_MAXQ && (1U << q) < tags; q++)
+            ;
+    }
+    air_us = timerStopwatch_us(&statWatch);
+    if (!status) hopChannelRelease();
+    if (done)
+    {
+        tags = sum / done;
+        for (invQ = 0; invQ < 15 && (1U << invQ) < tags; invQ++)
+            ;
+    }
+
+    IN_PACKET[0] = IN_TAG_COUNT_ID;
+    IN_PACKET[1] = 9;
+    IN_PACKET[2] = status;
+    u16ToBuffer(done ? tags : 0, &IN_PACKET[3]);
+    IN_PACKET[5] = done;
+    IN_PACKET[6] = q;
+    u16ToBuffer((air_us / 1000 > 0xffff) ? 0xffff : air_us / 1000, &IN_PACKET[7]);
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_TAG_COUNT_IDSize+1;
+    SendPacket(IN_TAG_COUNT_ID);
+}
+
+/** Operations of callAccessSequence() */
+#define SEQ_SELECT              0
+#define SEQ_ACCESS              1
+#define SEQ_READ                2
+#define SEQ_WRITE               3
+#define SEQ_LOCK                4
+/** Most steps in one sequence */
+#define SEQ_MAXSTEPS            16
+
+/* Singulates the tag matching mask for the steps of callAccessSequence() */
+static u8 sequenceSelect(u8 *mask, u8 masklen)
+{
+    num_of_tags = gen2SearchForTagsTimeout(tags_+1, 1, mask, masklen, 0, maxSendingLimit_slowTicks, 1);
+    if (num_of_tags == 0)
+    {
+        selectedTag = 0;
+        return GEN2_ERR_SELECT;
+    }
+    selectedTag = tags_+1;
+    handleValid = 1;
+    handleRound = gen2GetRoundCount();
+    return GEN2_OK;
+}
+
+/*! This function runs a sequence of access operations on one tag, e.g. select, access,
+  write, read back and lock for commissioning a tag. All steps run on one channel with
+  the carrier kept on and use the same handle, the tag is singulated only once. The
+  sequence stops at the first failing step.
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>  2 .. 5</th><th>    6</th><th>7 ..</th></tr>
+    <tr><th>Content</th><td>0x75(ID)</td><td>length</td><td>acces_pw</td><td>steps</td><td>step list</td></tr>
+  </table>
+  Each step is an operation byte followed by its parameters:
+  <table>
+    <tr><th>Operation</th><th>Parameters</th></tr>
+    <tr><td>0 select</td><td>mask_length, mask: singulates the tag with the given EPC mask</td></tr>
+    <tr><td>1 access</td><td>none: accesses the tag with acces_pw unless it is 0</td></tr>
+    <tr><td>2 read</td><td>mem_type, address, data_len: reads data_len words</td></tr>
+    <tr><td>3 write</td><td>mem_type, address, data_len, data: writes data_len words</td></tr>
+    <tr><td>4 lock</td><td>lock_unlock, memory_space: as in callLockUnlock()</td></tr>
+  </table>
+  If the first step is not a select the tag selected before with callSelectTag() is used.
+  There are at most 16 steps.
+  The device sends back:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>     2</th><th>   3</th><th>4 .. 3 + steps</th><th>4 + steps ..</th></tr>
+    <tr><th>Content</th><td>0x76(ID)</td><td>length</td><td>status</td><td>done</td><td>step status</td><td>read data</td></tr>
+  </table>
+  status is 0 if all steps succeeded, otherwise the status of the failing step or 0xff for
+  an invalid step list. done is the number of steps run, the step status bytes after them
+  are 0. The data of all read steps follows in order of the steps, it must fit into the
+  report.
+ */
+void callAccessSequence(void)
+{
+    u8 steps = getBuffer_[6];
+    u8 length = getBuffer_[1];
+    u8 pos = 7;
+    u8 done = 0;
+    u8 out;
+    u8 words, len;
+    u8 lmask[3];
+    u8 status = 0;
+
+    if (length > OUT_ACCESS_SEQ_IDSize + 1) length = OUT_ACCESS_SEQ_IDSize + 1;
+    if (steps > SEQ_MAXSTEPS)
+    {
+        steps = 0;
+        status = 0xff;
+    }
+    out = 4 + steps;
+    for (len = 4; len < out; len++) IN_PACKET[len] = 0;
+
+    checkAndSetSession(SESSION_GEN2);
+    if (!status) status = hopFrequencies();
+    if (!status && steps && getBuffer_[pos] != SEQ_SELECT)
+    {
+        powerAndSelectTag();
+        if (selectedTag == 0 || num_of_tags == 0) status = GEN2_ERR_SELECT;
+    }
+    while (!status && done < steps)
+    {
+        if (pos >= length)
+        {
+            status = 0xff;
+            break;
+        }
+        switch (getBuffer_[pos++])
+        {
+            case SEQ_SELECT:
+                len = getBuffer_[pos];
+                /* gen2Select() takes the mask length in bits as an u8 */
+                if (len > EPCLENGTH || pos + 1 + len > length) status = 0xff;
+                else status = sequenceSelect(&getBuffer_[pos + 1], len);
+                pos += 1 + len;
+                break;
+            case SEQ_ACCESS:
+                status = checkAndAccessTag(&getBuffer_[2]);
+                break;
+            case SEQ_READ:
+                words = getBuffer_[pos + 2];
+                if (pos + 3 > length || out + 2 * words > IN_ACCESS_SEQ_IDSize + 1) status = 0xff;
+                else status = gen2ReadFromTag(selectedTag, getBuffer_[pos], getBuffer_[pos + 1], words, &IN_PACKET[out]);
+                if (!status) out += 2 * words;
+                pos += 3;
+                break;
+            case SEQ_WRITE:
+                words = getBuffer_[pos + 2];
+                if (pos + 3 + 2 * words > length)
+                {
+                    status = 0xff;
+                    break;
+                }
+                len = writeMEM(getBuffer_[pos + 1], selectedTag, &getBuffer_[pos + 3], words, getBuffer_[pos], &status);
+                if (len != words && status == 0) status = 0xff;
+                pos += 3 + 2 * words;
+                break;
+            case SEQ_LOCK:
+                if (pos + 2 > length)
+                {
+                    status = 0xff;
+                    break;
+                }
+                lockMask(getBuffer_[pos], getBuffer_[pos + 1], lmask);
+                status = gen2LockTag(selectedTag, lmask);
+                pos += 2;
+                break;
+            default:
+                status = 0xff;
+                break;
+        }
+        if (!status && !continueCheckTimeout()) status = GEN2_ERR_CHANNEL_TIMEOUT;
+        IN_PACKET[4 + done++] = status;
+    }
+    hopChannelRelease();
+
+    IN_PACKET[0] = IN_ACCESS_SEQ_ID;
+    IN_PACKET[1] = out;
+    IN_PACKET[2] = status;
+    IN_PACKET[3] = done;
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_ACCESS_SEQ_IDSize+1;
+    SendPacket(IN_ACCESS_SEQ_ID);
+}
+
+/*! This function configures the tag memory cache, see tagcache.h. Repeated reads
+  (see callReadFromTag()) of words read before from the same tag are answered from
+  the cache without accessing the tag.
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>        1</th><th>  2</th><th>3 .. 4</th></tr>
+    <tr><th>Content</th><td>0x7B(ID)</td><td>5(length)</td><td>set</td><td>ttl</td></tr>
+  </table>
+  If set is 1 the time to live of cache entries is set to ttl ms, at most 60000. Entries
+  of the TID bank do not expire. 0 disables the cache, which is the default.
+  The device sends back:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>        1</th><th>     2</th><th>3 .. 4</th><th>      5</th><th>6 .. 7</th><th>8 .. 9</th></tr>
+    <tr><th>Content</th><td>0x7C(ID)</td><td>10(length)</td><td>status</td><td>ttl</td><td>entries</td><td>hits</td><td>misses</td></tr>
+  </table>
+  status is 0xff if the cache is not compiled in (see TAGCACHE in as399x_config.h), hits
+  and misses are counted since they were last reported here or with callInventoryStats().
+ */
+void callTagCache(void)
+{
+    u16 hits, misses;
+
+    if (getBuffer_[2] == 1) tagcacheSetTtl(getBuffer_[3] | (getBuffer_[4] << 8));
+    IN_PACKET[0] = IN_TAG_CACHE_ID;
+    IN_PACKET[1] = 10;
+    IN_PACKET[2] = TAGCACHE ? 0 : 0xff;
+    u16ToBuffer(tagcacheGetTtl(), &IN_PACKET[3]);
+    tagcacheGetStats(&hits, &misses, &IN_PACKET[5]);
+    u16ToBuffer(hits, &IN_PACKET[6]);
+    u16ToBuffer(misses, &IN_PACKET[8]);
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_TAG_CACHE_IDSize+1;
+    SendPacket(IN_TAG_CACHE_ID);
+}
+
+/** Words read at most by one Read of callStreamRead(), fills one report */
+#define STREAM_MAXCHUNK         28
+/** Failed Reads of one chunk before callStreamRead() gives up */
+#define STREAM_RETRIES          4
+/** Successful Reads after which callStreamRead() doubles the chunk size again */
+#define STREAM_GOOD_CHUNKS      4
+
+/* Singulates the selected tag again and accesses it, e.g. after a hop */
+static u8 streamReselect(u8 *password)
+{
+    powerAndSelectTag();
+    if (num_of_tags == 0) return GEN2_ERR_SELECT;
+    return checkAndAccessTag(password);
+}
+
+/*! This function reads a large memory area from a previously selected gen2 tag, e.g. the
+  log of a sensor tag, and streams it to the host in several reports. The area is read in
+  chunks of up to 28 words. After a failed Read the chunk size is halved and the chunk is
+  read again, after some successful Reads the chunk size is doubled again. The handle of
+  the tag is kept between chunks. If the allocation time of the channel expires (see
+  callChangeFreq()) the reader hops to the next channel, singulates the tag again and
+  continues.
+  The format of the report from the host is as follows:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>       2</th><th> 3 .. 4</th><th>     5 .. 6</th><th> 7 .. 10</th></tr>
+    <tr><th>Content</th><td>0x79(ID)</td><td>length</td><td>mem_type</td><td>address</td><td>word_count</td><td>acces_pw</td></tr>
+  </table>
+  address and word_count are in words. If acces_pw is nonzero the tag will be accessed first.
+  The device sends a report for every chunk read:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>     1</th><th>   2</th><th>3 .. 4</th><th>    5</th><th>6 ..</th></tr>
+    <tr><th>Content</th><td>0x7A(ID)</td><td>length</td><td>0</td><td>offset</td><td>words</td><td>data</td></tr>
+  </table>
+  offset is the word offset of the chunk from address. At the end it sends:
+  <table>
+    <tr><th>   Byte</th><th>       0</th><th>         1</th><th>     2</th><th>     3 .. 4</th><th>5</th><th>6 .. 7</th><th>   8</th></tr>
+    <tr><th>Content</th><td>0x7A(ID)</td><td>9(length)</td><td>status</td><td>words_read</td><td>0</td><td>crc</td><td>hops</td></tr>
+  </table>
+  crc is the CRC-16 (see calcCrc16()) of all data read, hops the number of channels changed.
+ */
+void callStreamRead(void)
+{
+    u8 memBank = getBuffer_[2];
+    u16 address = getBuffer_[3] | (getBuffer_[4] << 8);
+    u16 count = getBuffer_[5] | (getBuffer_[6] << 8);
+    u8 password[4];
+    u16 done = 0;
+    u16 crc = 0;
+    u8 chunk = STREAM_MAXCHUNK;
+    u8 n, retries = 0, good = 0, hops = 0;
+    u8 status;
+
+    copyBuffer(&getBuffer_[7], password, 4);
+#if CRC16_ENABLE
+    crc = CRC16_PRELOAD;
+#endif
+    checkAndSetSession(SESSION_GEN2);
+    POWER_AND_SELECT_TAG();
+    status = checkAndAccessTag(password);
+
+    while (!status && done < count)
+    {
+        if (!continueCheckTimeout())
+        {   /* the tag loses power with the carrier, it has to be singulated again */
+            hopChannelRelease();
+            status = hopFrequencies();
+            if (status) break;
+            hops++;
+            status = streamReselect(password);
+            continue;
+        }
+        n = (count - done < chunk) ? count - done : chunk;
+        status = gen2ReadFromTag(selectedTag, memBank, address + done, n, &IN_PACKET[6]);
+        if (status)
+        {
+            /* error codes of the tag, e.g. memory overrun or locked, are final */
+            if ((status & 0x80) || ++retries > STREAM_RETRIES) break;
+            if (chunk > 1) chunk >>= 1;
+            good = 0;
+            status = GEN2_OK;
+            if (gen2CheckHandle(selectedTag) != GEN2_OK) status = streamReselect(password);
+            continue;
+        }
+#if CRC16_ENABLE
+        crc = updateCrc16(crc, &IN_PACKET[6], 2 * n);
+#endif
+        IN_PACKET[0] = IN_STREAM_READ_ID;
+        IN_PACKET[1] = 6 + 2 * n;
+        IN_PACKET[2] = 0;
+        u16ToBuffer(done, &IN_PACKET[3]);
+        IN_PACKET[5] = n;
+        IN_BUFFER.Ptr = IN_PACKET;
+        IN_BUFFER.Length = IN_STREAM_READ_IDSize+1;
+        SendPacket(IN_STREAM_READ_ID);
+        done += n;
+        retries = 0;
+        if (++good >= STREAM_GOOD_CHUNKS && chunk < STREAM_MAXCHUNK)
+        {
+            chunk = (chunk > STREAM_MAXCHUNK / 2) ? STREAM_MAXCHUNK : 2 * chunk;
+            good = 0;
+        }
+    }
+
+exit:
+    hopChannelRelease();
+    IN_PACKET[0] = IN_STREAM_READ_ID;
+    IN_PACKET[1] = 9;
+    IN_PACKET[2] = status;
+    u16ToBuffer(done, &IN_PACKET[3]);
+    IN_PACKET[5] = 0;
+    u16ToBuffer(crc, &IN_PACKET[6]);
+    IN_PACKET[8] = hops;
+    IN_BUFFER.Ptr = IN_PACKET;
+    IN_BUFFER.Length = IN_STREAM_READ_IDSize+1;
+    SendPacket(IN_STREAM_READ_ID);
+}
+
 void initCommands(void)
 {
     currentSession = 0;
@@ -2790,31 +4022,47 @@ void initCommands(void)
 #endif
 }
 
-static s8 hopFrequencies(void)
+s8 hopFrequencies(void)
 {
     u8 i;
     u8 min_idx;
     s8 dBm = -128;
     u8 rssi;
     u16 refl = 0;
+#ifdef CONFIG_TUNER
+    u16 tuned, band;
+#endif
 
+    if (channelHeld)
+    {   /* reuse the held channel while its allocation time lasts and the carrier is still on */
+        channelHeld = 0;
+        if (continueCheckTimeout() && (as399xSingleRead(AS399X_REG_STATUSCTRL) & 0x01))
+        {
+            channelReused = 1;
+            return GEN2_OK;
+        }
+    }
+    channelReused = 0;
     maxSendingLimit_slowTicks = MS_2_SLOWTICKS(maxSendingTime - 16);
 
+    powerDownPending = 0;
+    timerSoftStop(TIMER_SOFT_POWERDOWN);
     as399xExitPowerDownMode();
     as399xAntennaPower(0);
 
     if ( MS_2_SLOWTICKS(idleTime) > timerMeasure_slowTicks())
     { /* if the time in between is larger than ~1min we wait unnecessarily. 
          but this won't hurt if the upper level was anyway waiting this long. */
-        mdelay(idleTime -  SLOWTICKS_2_MS(timerMeasure_slowTicks()));
+        schedWait_ms(idleTime -  SLOWTICKS_2_MS(timerMeasure_slowTicks()));
     }
     if (Frequencies.activefreq == 0)
     {
-        if (!cyclic) as399xEnterPowerDownMode();
+        if (!cyclic && !macroIsRunning() && !encoderIsRunning()) powerDownIdle();
         return GEN2_ERR_CHANNEL_TIMEOUT;
     }
 
     min_idx = currentFreqIdx;
+    TRACE_EVENT(TRACE_LBT_BEGIN, currentFreqIdx);
     for (i = 0; i< MAXFREQ; i++)
     {
         if ( ++currentFreqIdx >= Frequencies.activefreq ) currentFreqIdx = 0;
@@ -2824,6 +4072,7 @@ static s8 hopFrequencies(void)
         as399xGetRSSI(listeningTime,&rssi,&dBm);
         if (dBm <= Frequencies.rssiThreshold[currentFreqIdx]) break; /* Found free frequency, now we can return */
     }
+    TRACE_EVENT(TRACE_LBT_END, currentFreqIdx);
     if (dBm <= Frequencies.rssiThreshold[currentFreqIdx])
     {
         timerStartMeasure();
@@ -2832,6 +4081,7 @@ static s8 hopFrequencies(void)
         applyTunerSettingForFreq(Frequencies.freq[currentFreqIdx]);
 #endif
         as399xAntennaPower(1);
+        TRACE_EVENT(TRACE_HOP, currentFreqIdx);
 #ifdef CONFIG_TUNER
         if ( tuningTable.tableSize > 0 &&
                 ++Frequencies.countFreqHop[currentFreqIdx] > 150 )
@@ -2845,8 +4095,9 @@ static s8 hopFrequencies(void)
             CON_print("measured reflected power: %hx\n", refl);
 #endif
             Frequencies.countFreqHop[currentFreqIdx] = 0;
-            if ( refl > tuningTable.tunedIQ[usedAntenna-1][tuningTable.currentEntry] * 1.3 ||
-                    refl < tuningTable.tunedIQ[usedAntenna-1][tuningTable.currentEntry] * 0.7 )
+            tuned = tuningTable.tunedIQ[usedAntenna-1][tuningTable.currentEntry];
+            band = ((u32)tuned * 77) >> 8;     /* 30% as 77/256 */
+            if ( refl > (u32)tuned + band || refl < tuned - band )
                 /* if reflected power differs 30% compared to last tuning time, redo tuning */
             {
                 tunerOneHillClimb(&antennaParams, 100);
@@ -2876,16 +4127,146 @@ static s8 hopFrequencies(void)
 #endif
         timedOut = 1;
         as399xAntennaPower(0);
-        if (!cyclic) as399xEnterPowerDownMode();
+        if (!cyclic && !macroIsRunning() && !encoderIsRunning()) powerDownIdle();
         return GEN2_ERR_CHANNEL_TIMEOUT;
     }
 }
 
-static void hopChannelRelease(void)
+void hopChannelRelease(void)
 {
+    if (carrierHold && !timedOut && continueCheckTimeout())
+    {
+        channelHeld = 1;
+        return;
+    }
+    channelRelease();
+}
+
+/*------------------------------------------------------------------------- */
+/** Switches the carrier off, also a held one, and powers the AS399x down
+  * unless cyclic inventory, a macro program or an encoding job is running. */
+static void channelRelease(void)
+{
+    channelHeld = 0;
     timerStartMeasure();
     as399xAntennaPower(0);
-    if (!cyclic) as399xEnterPowerDownMode();
+    if (!cyclic && !macroIsRunning() && !encoderIsRunning()) powerDownIdle();
+}
+
+/*------------------------------------------------------------------------- */
+/** Powers the AS399x down after powerDownDelay ms without activity, immediately
+  * if it is 0. */
+static void powerDownIdle(void)
+{
+    if (powerDownDelay == 0)
+    {
+        as399xEnterPowerDownMode();
+        return;
+    }
+    powerDownPending = 1;
+    timerSoftStart(TIMER_SOFT_POWERDOWN, MS_2_SLOWTICKS(powerDownDelay), 0);
+}
+
+/*------------------------------------------------------------------------- */
+/** @return 1 if the idle time before power down expired */
+static bool powerDownDue(void)
+{
+    if (!powerDownPending) return 0;
+    timerService();
+    return !timerSoftRunning(TIMER_SOFT_POWERDOWN);
+}
+
+/*------------------------------------------------------------------------- */
+/** Restarts the idle time before power down if a command is received, powers
+  * down if it expired. */
+static void powerDownService(bool activity)
+{
+    if (!powerDownPending) return;
+    if (activity)
+    {
+        timerSoftStart(TIMER_SOFT_POWERDOWN, MS_2_SLOWTICKS(powerDownDelay), 0);
+        return;
+    }
+    if (!powerDownDue()) return;
+    powerDownPending = 0;
+    if (!channelHeld && !cyclic && !macroIsRunning() && !encoderIsRunning()) as399xEnterPowerDownMode();
+}
+
+/*------------------------------------------------------------------------- */
+/** Wakes up the AS399x if it was put into low power mode between duty cycled
+  * cyclic inventory rounds. */
+static void cyclicWakeUp(void)
+{
+    u16 now;
+
+    if (!cyclicSleeping) return;
+    cyclicSleeping = 0;
+    timerSoftStop(TIMER_SOFT_DUTY);
+    now = timerSlowTicks();
+    cyclicOffTicks += (u16)(now - cyclicPhaseStart);
+    cyclicPhaseStart = now;
+    timerStopwatchStart(&cyclicWakeWatch);
+    cyclicWakePending = 1;
+    if (cyclicDutyMode == CYCLIC_DUTY_STANDBY)
+        as399xExitStandbyMode();
+    /* power down mode is left by hopFrequencies() */
+}
+
+/*------------------------------------------------------------------------- */
+/** Puts the AS399x into the low power mode selected by callStartStop() and
+  * starts the timer for the next cyclic inventory round. */
+static void cyclicSleep(void)
+{
+    u16 now;
+
+    if (!cyclic || cyclicDutyMode == CYCLIC_DUTY_OFF) return;
+    if (channelHeld) channelRelease();
+    powerDownPending = 0;
+    timerSoftStop(TIMER_SOFT_POWERDOWN);
+    now = timerSlowTicks();
+    cyclicOnTicks += (u16)(now - cyclicPhaseStart);
+    cyclicPhaseStart = now;
+    if (cyclicDutyMode == CYCLIC_DUTY_STANDBY)
+        as399xEnterStandbyMode();
+    else
+        as399xEnterPowerDownMode();
+    cyclicSleeping = 1;
+    timerSoftStart(TIMER_SOFT_DUTY, MS_2_SLOWTICKS(cyclicOffTime), 0);
+}
+
+/*------------------------------------------------------------------------- */
+/** @return 1 if the next cyclic inventory round is due */
+static bool cyclicDue(void)
+{
+    if (!cyclic) return 0;
+    if (!cyclicSleeping) return 1;
+    timerService();
+    return !timerSoftRunning(TIMER_SOFT_DUTY);
+}
+
+/*------------------------------------------------------------------------- */
+bool commandsPending(void)
+{
+#if UARTSUPPORT
+    if (uartState != UART_IDLE || checkByte()) return 1;
+#else
+    if (getReceiveFlag()) return 1;
+#endif
+    return cyclicDue() || macroIsRunning() || encoderIsRunning() || carrierHoldExpired() || powerDownDue();
+}
+
+/*------------------------------------------------------------------------- */
+/** @return 1 if the carrier is held and the allocation time of the channel expired */
+static bool carrierHoldExpired(void)
+{
+    return channelHeld && timerMeasure_slowTicks() > maxSendingLimit_slowTicks;
+}
+
+/*------------------------------------------------------------------------- */
+/** Switches the carrier off if it is held beyond the allocation time of the channel */
+static void carrierHoldService(void)
+{
+    if (carrierHoldExpired()) channelRelease();
 }
 
 /*------------------------------------------------------------------------- */
@@ -2893,12 +4274,19 @@ static void hopChannelRelease(void)
 /*USB. */
 void commands(void)
 {
+    carrierHoldService();
+    tagcacheService();
+    powerDownService(getReceiveFlag());
     if (getReceiveFlag())
     {
 #if USBCOMMDEBUG
         CON_print("IN %hhx\n",USB_COMMAND);
 #endif
+        cyclicWakeUp();
         cyclic = 0;
+        /* any other command stops a running macro program, like cyclic inventory */
+        if (USB_COMMAND != OUT_MACRO_ID) macroStop();
+        if (USB_COMMAND != OUT_ENCODER_ID) encoderStop();
         /* Special handling for start/stop command sent without waiting for reply ... ugly ..*/
         if (USB_COMMAND != 0x5d) as399xExitPowerDownMode();
         call_fkt_[USB_COMMAND]();
@@ -2907,7 +4295,20 @@ void commands(void)
     }
     if (cyclic)
     {
-        callInventoryRSSIInternal(1);
+        if (cyclicDue())
+        {
+            cyclicWakeUp();
+            callInventoryRSSIInternal(1);
+            cyclicSleep();
+        }
+    }
+    else if (macroIsRunning())
+    {
+        macroRun();
+    }
+    else if (encoderIsRunning())
+    {
+        encoderRun();
     }
 }
 
@@ -2921,6 +4322,9 @@ void uartCommands(void)
     static u8 pointer;
     u8 i;
 
+    carrierHoldService();
+    tagcacheService();
+    powerDownService(uartState != UART_IDLE || checkByte());
     switch (uartState)
     {
         case UART_IDLE:    /* Wait for Bytes to be received */
@@ -2951,6 +4355,9 @@ void uartCommands(void)
                 for (i=0;i<64;i++)   IN_PACKET[i]=0;  /* Clear the Buffer */
                 uartState=UART_IDLE;
                 uartFlag=1;
+                cyclicWakeUp();
+                if (getBuffer_[0] != OUT_MACRO_ID) macroStop();
+                if (getBuffer_[0] != OUT_ENCODER_ID) encoderStop();
                 as399xExitPowerDownMode();
                 call_fkt_[getBuffer_[0]]();           /* execute command */
                 uartFlag=0;
@@ -2961,7 +4368,20 @@ void uartCommands(void)
     }
     if (cyclic)
     {
-        callInventoryRSSIInternal(1);
+        if (cyclicDue())
+        {
+            cyclicWakeUp();
+            callInventoryRSSIInternal(1);
+            cyclicSleep();
+        }
+    }
+    else if (macroIsRunning())
+    {
+        macroRun();
+    }
+    else if (encoderIsRunning())
+    {
+        encoderRun();
     }
 }
 #endif
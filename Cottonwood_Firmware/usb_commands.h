@@ -31,10 +31,31 @@
 #define __USB_COMMANDS_H__
 
 #include "global.h"
+#include "as399x_public.h"
 
 extern void commands(void);
 extern void initCommands(void);
 extern void uartCommands(void) ;
+/** @return 1 if commands() or uartCommands() have work to do, i.e. a command
+  * has been received or cyclic inventory or a macro program is running. */
+extern bool commandsPending(void);
+
+/* Helpers shared with autonomous command sources like the macro engine */
+#define SESSION_GEN2            1
+#define SESSION_ISO6B           2
+
+extern XDATA Tag tags_[MAXTAG];
+
+extern void checkAndSetSession(u8 newSession);
+extern bool continueCheckTimeout(void);
+extern s8 hopFrequencies(void);
+extern void hopChannelRelease(void);
+extern u8 writeMEM(u8 memAdress, Tag *tag, u8 *data_buf, u8 data_length_words, u8 mem_type, u8* status);
+
+#if UARTSUPPORT
+extern void uartSendPacket(void);
+#define SendPacket( A ) uartSendPacket()
+#endif
 
 
 extern CODE void (* const call_fkt_[256])(void);
@@ -124,6 +145,49 @@ extern CODE void (* const call_fkt_[256])(void);
 #define OUT_GENERIC_COMMAND_ID  0x5F
 #define IN_GENERIC_COMMAND_ID   0x60
 
+/* Macro engine */
+#define OUT_MACRO_ID            0x61
+#define IN_MACRO_ID             0x62
+
+#define OUT_SYS_STATUS_ID       0x63
+#define IN_SYS_STATUS_ID        0x64
+
+#define OUT_INVENTORY_STATS_ID  0x65
+#define IN_INVENTORY_STATS_ID   0x66
+
+#define OUT_TRACE_DUMP_ID       0x67
+#define IN_TRACE_DUMP_ID        0x68
+
+#define OUT_BENCH_ID            0x69
+#define IN_BENCH_ID             0x6A
+
+#define OUT_PROFILE_CTRL_ID     0x6B
+#define IN_PROFILE_CTRL_ID      0x6C
+
+#define OUT_TAG_COUNT_ID        0x6D
+#define IN_TAG_COUNT_ID         0x6E
+
+#define OUT_WATCHLIST_ID        0x6F
+#define IN_WATCHLIST_ID         0x70
+
+#define OUT_CARRIER_HOLD_ID     0x71
+#define IN_CARRIER_HOLD_ID      0x72
+
+#define OUT_POWER_CTRL_ID       0x73
+#define IN_POWER_CTRL_ID        0x74
+
+#define OUT_ACCESS_SEQ_ID       0x75
+#define IN_ACCESS_SEQ_ID        0x76
+
+#define OUT_ENCODER_ID          0x77
+#define IN_ENCODER_ID           0x78
+
+#define OUT_STREAM_READ_ID      0x79
+#define IN_STREAM_READ_ID       0x7A
+
+#define OUT_TAG_CACHE_ID        0x7B
+#define IN_TAG_CACHE_ID         0x7C
+
 
 /*WRONG USB COMMAND */
 #define IN_COMMAND_WRONG_ID     0xff
@@ -199,6 +263,48 @@ extern CODE void (* const call_fkt_[256])(void);
 #define OUT_GENERIC_COMMAND_IDSize 0x3f
 #define IN_GENERIC_COMMAND_IDSize  0x3f
 
+#define OUT_MACRO_IDSize           0x3f
+#define IN_MACRO_IDSize            0x3f
+
+#define OUT_SYS_STATUS_IDSize      0x02
+#define IN_SYS_STATUS_IDSize       0x3f
+
+#define OUT_INVENTORY_STATS_IDSize 0x03
+#define IN_INVENTORY_STATS_IDSize  0x3f
+
+#define OUT_TRACE_DUMP_IDSize      0x03
+#define IN_TRACE_DUMP_IDSize       0x3f
+
+#define OUT_BENCH_IDSize           0x03
+#define IN_BENCH_IDSize            0x3f
+
+#define OUT_PROFILE_CTRL_IDSize    0x0a
+#define IN_PROFILE_CTRL_IDSize     0x3f
+
+#define OUT_TAG_COUNT_IDSize       0x04
+#define IN_TAG_COUNT_IDSize        0x3f
+
+#define OUT_WATCHLIST_IDSize       0x3f
+#define IN_WATCHLIST_IDSize        0x3f
+
+#define OUT_CARRIER_HOLD_IDSize    0x03
+#define IN_CARRIER_HOLD_IDSize     0x3f
+
+#define OUT_POWER_CTRL_IDSize      0x05
+#define IN_POWER_CTRL_IDSize       0x3f
+
+#define OUT_ACCESS_SEQ_IDSize      0x3f
+#define IN_ACCESS_SEQ_IDSize       0x3f
+
+#define OUT_ENCODER_IDSize         0x3f
+#define IN_ENCODER_IDSize          0x3f
+
+#define OUT_STREAM_READ_IDSize     0x0b
+#define IN_STREAM_READ_IDSize      0x3f
+
+#define OUT_TAG_CACHE_IDSize       0x05
+#define IN_TAG_CACHE_IDSize        0x3f
+
 #define OUT_AUTHENTICATE_IDSize		0x3f
 #define IN_AUTHENTICATE_IDSize		0x3f
 
@@ -234,6 +340,14 @@ extern CODE void (* const call_fkt_[256])(void);
 #define STARTINVENTORY          0x01
 #define NEXTTID                 0x02
 
+/*Command Read From Tag, flags */
+#define READ_FLAG_BYPASS_CACHE  0x01
+
+/*Command Start/Stop, duty modes */
+#define CYCLIC_DUTY_OFF         0x00
+#define CYCLIC_DUTY_STANDBY     0x01
+#define CYCLIC_DUTY_POWERDOWN   0x02
+
 #define LENGTH_BYTE             0x01
 
 #endif
@@ -63,6 +63,20 @@ void callGenericCommand(void);
 void callAuthenticateCommand(void);
 void callChallengeCommand(void);
 void callReadBufferCommand(void);
+void callMacroCommand(void);
+void callSysStatus(void);
+void callInventoryStats(void);
+void callTraceDump(void);
+void callBench(void);
+void callProfileControl(void);
+void callTagCount(void);
+void callWatchlist(void);
+void callCarrierHold(void);
+void callPowerControl(void);
+void callAccessSequence(void);
+void callEncoder(void);
+void callStreamRead(void);
+void callTagCache(void);
 
 /**
  * Table of function pointers. The offset in the table matches the command identifier.
@@ -167,33 +181,33 @@ CODE void (*const call_fkt_[256])(void) =
     callWrongCommand, /* 94 */
     callGenericCommand,			/* OUT_GENERIC_COMMAND_ID	   	*/
     callWrongCommand, /* 96 */
-    callWrongCommand, /* 97 */
+    callMacroCommand          , /* OUT_MACRO_ID                */
     callWrongCommand, /* 98 */
-    callWrongCommand, /* 99 */
+    callSysStatus             , /* OUT_SYS_STATUS_ID           */
     callWrongCommand, /* 100 */
-    callWrongCommand, /* 101 */
+    callInventoryStats        , /* OUT_INVENTORY_STATS_ID      */
     callWrongCommand, /* 102 */
-    callWrongCommand, /* 103 */
+    callTraceDump             , /* OUT_TRACE_DUMP_ID           */
     callWrongCommand, /* 104 */
-    callWrongCommand, /* 105 */
+    callBench                 , /* OUT_BENCH_ID                */
     callWrongCommand, /* 106 */
-    callWrongCommand, /* 107 */
+    callProfileControl        , /* OUT_PROFILE_CTRL_ID         */
     callWrongCommand, /* 108 */
-    callWrongCommand, /* 109 */
+    callTagCount              , /* OUT_TAG_COUNT_ID            */
     callWrongCommand, /* 110 */
-    callWrongCommand, /* 111 */
+    callWatchlist             , /* OUT_WATCHLIST_ID            */
     callWrongCommand, /* 112 */
-    callWrongCommand, /* 113 */
+    callCarrierHold           , /* OUT_CARRIER_HOLD_ID         */
     callWrongCommand, /* 114 */
-    callWrongCommand, /* 115 */
+    callPowerControl          , /* OUT_POWER_CTRL_ID           */
     callWrongCommand, /* 116 */
-    callWrongCommand, /* 117 */
+    callAccessSequence        , /* OUT_ACCESS_SEQ_ID           */
     callWrongCommand, /* 118 */
-    callWrongCommand, /* 119 */
+    callEncoder               , /* OUT_ENCODER_ID              */
     callWrongCommand, /* 120 */
-    callWrongCommand, /* 121 */
+    callStreamRead            , /* OUT_STREAM_READ_ID          */
     callWrongCommand, /* 122 */
-    callWrongCommand, /* 123 */
+    callTagCache              , /* OUT_TAG_CACHE_ID            */
     callWrongCommand, /* 124 */
     callWrongCommand, /* 125 */
     callWrongCommand, /* 126 */
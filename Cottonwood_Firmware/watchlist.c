@@ -0,0 +1,119 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief Implementation of the EPC watchlist, see watchlist.h
+  */
+#include "as399x_config.h"
+#include "global.h"
+#include "crc16.h"
+#include "F340_FlashPrimitives.h"
+#include "watchlist.h"
+#include "string.h"
+
+#if WATCHLIST
+#if !CRC16_ENABLE
+#error WATCHLIST requires CRC16_ENABLE
+#endif
+
+#if HOSTSIM
+extern u8 simFlash[]; /* host/hw.c */
+static const u8 CODE *watchlistBits_ = simFlash + WATCHLIST_ADDR;
+#else
+static const u8 CODE *watchlistBits_ = (const u8 CODE *)WATCHLIST_ADDR;
+#endif
+static u8 watchlistK_;
+
+/** Second hash for the double hashing of the filter, rotate and add. Has to be
+  * the same as in watchlist.pl. */
+static u16 watchlistHash(const u8 *epc, u8 len)
+{
+    u16 h = 0x5a5a;
+
+    while (len--)
+    {
+        h = ((h << 5) | (h >> 11)) + *epc++;
+    }
+    return h | 1;
+}
+
+void watchlistErase(void)
+{
+    u16 addr;
+
+    for (addr = 0; addr < WATCHLIST_BYTES; addr += FLASH_PAGESIZE)
+    {
+        FLASH_PageErase(WATCHLIST_ADDR + addr);
+    }
+}
+
+u8 watchlistWrite(u16 offset, const u8 *buf, u8 len)
+{
+    if (offset >= WATCHLIST_BYTES || len > WATCHLIST_BYTES - offset) return 0xff;
+    while (len--)
+    {
+        if (*buf != 0xff) /* erased flash is 0xff already */
+            FLASH_ByteWrite(WATCHLIST_ADDR + offset, *buf);
+        buf++;
+        offset++;
+    }
+    return 0;
+}
+
+void watchlistSetK(u8 k)
+{
+    watchlistK_ = (k > WATCHLIST_MAXK) ? WATCHLIST_MAXK : k;
+}
+
+u8 watchlistGetK(void)
+{
+    return watchlistK_;
+}
+
+bool watchlistContains(const u8 *epc, u8 len)
+{
+    u16 h1 = calcCrc16(epc, len);
+    u16 h2 = watchlistHash(epc, len);
+    u16 idx;
+    u8 i;
+
+    for (i = 0; i < watchlistK_; i++)
+    {
+        idx = h1 & (WATCHLIST_BITS - 1);
+        if (!(watchlistBits_[idx >> 3] & (1 << (idx & 7)))) return 0;
+        h1 += h2;
+    }
+    return 1;
+}
+
+u8 watchlistFilter(Tag *tags, u8 num)
+{
+    u8 i, kept = 0;
+
+    for (i = 0; i < num; i++)
+    {
+        if (!watchlistContains(tags[i].epc, tags[i].epclen)) continue;
+        if (kept != i) memcpy(&tags[kept], &tags[i], sizeof(Tag));
+        kept++;
+    }
+    return kept;
+}
+#endif
@@ -0,0 +1,74 @@
+/*
+ *****************************************************************************
+ * Copyright by ams AG                                                       *
+ * All rights are reserved.                                                  *
+ *                                                                           *
+ * IMPORTANT - PLEASE READ CAREFULLY BEFORE COPYING, INSTALLING OR USING     *
+ * THE SOFTWARE.                                                             *
+ *                                                                           *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS       *
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT         *
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS         *
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT  *
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,     *
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT          *
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,     *
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY     *
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT       *
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE     *
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.      *
+ *****************************************************************************
+ */
+/** @file
+  * @brief This file is the include file for the watchlist.c file.
+  *
+  * If #WATCHLIST is set in as399x_config.h a Bloom filter of EPCs can be
+  * stored in the flash pages WATCHLIST_ADDR .. WATCHLIST_ADDR + WATCHLIST_BYTES - 1.
+  * The filter is built on the host (watchlist.pl) and uploaded in chunks with
+  * callWatchlist(). Each EPC sets k bits, bit i is (h1 + i * h2) mod
+  * WATCHLIST_BITS with h1 the CRC-16 (see calcCrc16()) of the EPC and h2 the
+  * odd hash of watchlistHash(). With 2000 EPCs and k = 6, the value chosen by
+  * watchlist.pl, about 2% of the tags not on the list are reported as match.
+  * The filter survives a reset but is lost if a firmware update erases
+  * these pages.
+  */
+
+#ifndef __WATCHLIST_H__
+#define __WATCHLIST_H__
+
+#include "as399x_config.h"
+#include "global.h"
+#include "gen2.h"
+
+/** Start of the filter in flash, has to be at a page boundary. The code is
+  * linked below this address, see LDFLAGS in the Makefile. */
+#define WATCHLIST_ADDR          0xF000
+/** Size of the filter in bytes, 4 flash pages */
+#define WATCHLIST_BYTES         2048
+/** Size of the filter in bits, has to be a power of 2 */
+#define WATCHLIST_BITS          (WATCHLIST_BYTES * 8UL)
+/** Largest number of hash functions */
+#define WATCHLIST_MAXK          8
+
+/** Erases the filter, all bits are set afterwards, i.e. every EPC matches. */
+void watchlistErase(void);
+
+/** Writes len bytes of the filter starting at offset. Each byte may only be
+  * written once after watchlistErase().
+  * @return 0 on success, 0xff if the range is outside the filter */
+u8 watchlistWrite(u16 offset, const u8 *buf, u8 len);
+
+/** Sets the number of hash functions used by the filter, 0 disables matching. */
+void watchlistSetK(u8 k);
+
+/** @return the number of hash functions, 0 if no filter is set */
+u8 watchlistGetK(void);
+
+/** @return 1 if the epc of len bytes is probably on the list, 0 if it is not */
+bool watchlistContains(const u8 *epc, u8 len);
+
+/** Removes the tags not on the list from tags, the remaining ones keep their order.
+  * @return the number of tags remaining */
+u8 watchlistFilter(Tag *tags, u8 num);
+
+#endif /* __WATCHLIST_H__ */
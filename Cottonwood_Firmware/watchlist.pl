@@ -0,0 +1,130 @@
+#!/usr/bin/perl
+#
+# Builds the EPC watchlist Bloom filter (see watchlist.h) from a list of
+# EPCs and uploads it with report 0x6F (see callWatchlist() in
+# usb_commands.c). Requires a firmware built with WATCHLIST set in
+# as399x_config.h.
+#
+# The EPC file contains one EPC per line as hex, e.g.
+#   3008 33b2 ddd9 0140 0000 0000
+# Blanks are ignored, lines starting with # too.
+#
+# Without -d the reports are printed as hex, one per line, e.g. for a host
+# software talking USB. With -d they are sent over a serial line (firmware
+# built with UARTSUPPORT) and the replies are checked.
+#
+# usage: watchlist.pl [-k hashes] [-a alive] [-d /dev/ttyUSB0] [-b 115200] epcs.txt
+#   -k  number of hash functions (default: best for the number of EPCs, at most 8)
+#   -a  send an alive report every alive cyclic rounds without match (default 0)
+#
+use strict;
+use warnings;
+use Getopt::Std;
+
+my %opt;
+getopts('k:a:d:b:', \%opt) or die "usage: $0 [-k hashes] [-a alive] [-d dev] [-b baud] epcs.txt\n";
+
+my $BYTES = 2048;           # WATCHLIST_BYTES
+my $BITS  = $BYTES * 8;
+my $CHUNK = 56;             # WATCHLIST_CHUNK
+
+my @epcs;
+while (my $line = <>)
+{
+    next if ($line =~ /^\s*#/);
+    $line =~ s/\s+//g;
+    next if ($line eq "");
+    die "not an EPC: $line\n" if ($line !~ /^([0-9a-fA-F]{2})+$/);
+    push @epcs, [ map { hex } ($line =~ /(..)/g) ];
+}
+die "no EPCs given\n" unless (@epcs);
+
+my $k = $opt{k} // int($BITS / @epcs * log(2) + 0.5);
+$k = 1 if ($k < 1);
+$k = 8 if ($k > 8);
+
+# CRC-16/CCITT with preload 0xffff, as calcCrc16()
+sub crc16
+{
+    my $crc = 0xffff;
+    foreach my $b (@_)
+    {
+        $crc ^= $b << 8;
+        for (1 .. 8)
+        {
+            $crc = ($crc & 0x8000) ? (($crc << 1) ^ 0x1021) : ($crc << 1);
+            $crc &= 0xffff;
+        }
+    }
+    return $crc;
+}
+
+# as watchlistHash()
+sub hash2
+{
+    my $h = 0x5a5a;
+    $h = ((($h << 5) | ($h >> 11)) + $_) & 0xffff foreach (@_);
+    return $h | 1;
+}
+
+my @filter = (0) x $BYTES;
+foreach my $epc (@epcs)
+{
+    my ($h1, $h2) = (crc16(@$epc), hash2(@$epc));
+    for (1 .. $k)
+    {
+        my $bit = $h1 & ($BITS - 1);
+        $filter[$bit >> 3] |= 1 << ($bit & 7);
+        $h1 = ($h1 + $h2) & 0xffff;
+    }
+}
+my $set = 0;
+foreach my $b (@filter)
+{
+    $set += ($b >> $_) & 1 for (0 .. 7);
+}
+printf STDERR "%d EPCs, k = %d, %.1f%% of the bits set, about %.2f%% false matches\n",
+    scalar @epcs, $k, 100 * $set / $BITS, 100 * ($set / $BITS) ** $k;
+
+my @reports = ([ 0x6F, 3, 1 ]);
+for (my $o = 0; $o < $BYTES; $o += $CHUNK)
+{
+    my $n = ($BYTES - $o < $CHUNK) ? $BYTES - $o : $CHUNK;
+    push @reports, [ 0x6F, 6 + $n, 2, $o & 0xff, $o >> 8, $n, @filter[$o .. $o + $n - 1] ];
+}
+push @reports, [ 0x6F, 5, 0, $k, $opt{a} // 0 ];
+
+unless ($opt{d})
+{
+    print join(" ", map { sprintf("%02x", $_) } @$_), "\n" foreach (@reports);
+    exit 0;
+}
+
+my $dev = $opt{d};
+system("stty", "-F", $dev, $opt{b} // 115200, "raw", "-echo", "-crtscts", "cs8", "-cstopb", "-parenb") == 0
+    or die "could not configure $dev\n";
+open(my $fh, '+<:raw', $dev) or die "$dev: $!\n";
+
+# reads one report, the erase may take some 100ms
+sub receiveReport
+{
+    my $buf = "";
+    for (;;)
+    {
+        my $rin = "";
+        vec($rin, fileno($fh), 1) = 1;
+        die "no reply from $dev\n" unless (select(my $rout = $rin, undef, undef, 2));
+        sysread($fh, my $chunk, 64) or die "read failed: $!\n";
+        $buf .= $chunk;
+        return unpack("C*", $buf) if (length($buf) >= 2 && length($buf) >= ord(substr($buf, 1, 1)));
+    }
+}
+
+foreach my $r (@reports)
+{
+    syswrite($fh, pack("C*", @$r)) == @$r or die "write failed: $!\n";
+    my @reply = receiveReport();
+    die sprintf("report %s failed, status %02x\n", join(" ", map { sprintf("%02x", $_) } @$r[0 .. 5]), $reply[2] // 0xff)
+        if ($reply[0] != 0x70 || $reply[2] != 0);
+}
+print STDERR "watchlist uploaded and active\n";